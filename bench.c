@@ -0,0 +1,197 @@
+/*
+ * bench.c - benchmark of the min and max kernels of the value columns
+ *
+ * Build and run with: make bench
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+
+#define DEBUG_IMPLEMENT
+#include "debug.h"
+
+#define FILE_IMPLEMENT
+#include "file.h"
+
+#define STOCK_IMPLEMENT
+#include "stock.h"
+
+/*
+ * Values scanned per size, spread over repeated calls
+ */
+#define BENCH_VALUES 20000000
+
+/*
+ * Get the current time in microseconds
+ */
+static double bench_time_get(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+
+  return now.tv_sec * 1e6 + now.tv_nsec / 1e3;
+}
+
+/*
+ * Get max of count numbers with a plain loop, as before the kernels
+ */
+static double bench_column_max(const double* column, size_t count)
+{
+  double max = column[0];
+
+  for (size_t index = 1; index < count; index++)
+  {
+    max = MAX(max, column[index]);
+  }
+
+  return max;
+}
+
+/*
+ * Get min of count numbers with a plain loop, as before the kernels
+ */
+static double bench_column_min(const double* column, size_t count)
+{
+  double min = column[0];
+
+  for (size_t index = 1; index < count; index++)
+  {
+    min = MIN(min, column[index]);
+  }
+
+  return min;
+}
+
+typedef double (*bench_column_t)(const double*, size_t);
+
+/*
+ * Get the microseconds of one max of high and min of low
+ */
+static double bench_run(bench_column_t max, bench_column_t min, const stock_values_t* values)
+{
+  size_t repeats = BENCH_VALUES / values->count;
+
+  volatile double sink = 0;
+
+  double start = bench_time_get();
+
+  for (size_t repeat = 0; repeat < repeats; repeat++)
+  {
+    sink += max(values->high, values->count) + min(values->low, values->count);
+  }
+
+  (void) sink;
+
+  return (bench_time_get() - start) / repeats;
+}
+
+/*
+ * Fill count values with a wandering price
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate memory
+ */
+static int bench_values_fill(stock_values_t* values, size_t count)
+{
+  if (stock_values_reserve(values, count) != 0)
+  {
+    return 1;
+  }
+
+  double price = 100;
+
+  for (size_t index = 0; index < count; index++)
+  {
+    price += (rand() % 201 - 100) / 1000.0;
+
+    values->time[index]   = index * 60;
+    values->volume[index] = rand() % 1000;
+    values->open[index]   = price;
+    values->close[index]  = price;
+    values->high[index]   = price + (rand() % 100) / 100.0;
+    values->low[index]    = price - (rand() % 100) / 100.0;
+  }
+
+  values->count = count;
+
+  return 0;
+}
+
+/*
+ * Benchmark the kernels on count values
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate memory
+ * - 2 | A kernel disagrees with the plain loop
+ */
+static int bench_size(size_t count)
+{
+  stock_values_t values = { 0 };
+
+  if (bench_values_fill(&values, count) != 0)
+  {
+    return 1;
+  }
+
+  double high = bench_column_max(values.high, count);
+  double low  = bench_column_min(values.low,  count);
+
+  if (stock_column_max(values.high, count) != high ||
+      stock_column_min(values.low,  count) != low)
+  {
+    stock_values_free(&values);
+
+    return 2;
+  }
+
+  printf("%6zu values | scalar %8.2f us", count, bench_run(bench_column_max, bench_column_min, &values));
+
+#ifdef STOCK_SIMD
+  printf(" | sse2 %8.2f us", bench_run(stock_column_max_sse2, stock_column_min_sse2, &values));
+
+  if (stock_simd_avx2_get())
+  {
+    printf(" | avx2 %8.2f us", bench_run(stock_column_max_avx2, stock_column_min_avx2, &values));
+  }
+#endif
+
+  printf("\n");
+
+  stock_values_free(&values);
+
+  return 0;
+}
+
+/*
+ * Main function
+ */
+int main(void)
+{
+  size_t counts[] = { 10000, 30000, 100000 };
+
+  size_t count = sizeof(counts) / sizeof(*counts);
+
+  srand(1);
+
+  printf("Max of high and min of low, per call\n");
+
+  for (size_t index = 0; index < count; index++)
+  {
+    int status = bench_size(counts[index]);
+
+    if (status != 0)
+    {
+      error_print("Benchmark of %zu values failed: %d", counts[index], status);
+
+      return 1;
+    }
+  }
+
+  return 0;
+}
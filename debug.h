@@ -35,11 +35,11 @@
 
 #include <stdio.h>
 
-extern int debug_print(FILE* stream, const char* title, const char* format, ...);
+extern int debug_print(FILE* stream, const char* title, const char* format, ...) __attribute__((format(printf, 3, 4)));
 
-extern int error_print(const char* format, ...);
+extern int error_print(const char* format, ...) __attribute__((format(printf, 1, 2)));
 
-extern int info_print(const char* format, ...);
+extern int info_print(const char* format, ...) __attribute__((format(printf, 1, 2)));
 
 
 extern int debug_file_open(const char* filepath);
@@ -19,6 +19,14 @@
  *
  * int    file_rename(const char* old_filepath, const char* new_filepath)
  *
+ * size_t file_write_atomic(const void* pointer, size_t size, const char* filepath)
+ *
+ * size_t file_write_replace(const void* pointer, size_t size, const char* filepath)
+ *
+ * void*  file_map(size_t* size, const char* filepath)
+ *
+ * void   file_unmap(void* pointer, size_t size)
+ *
  *
  * size_t file_lines_read(char*** lines, size_t size, const char* filepath)
  *
@@ -43,6 +51,12 @@
  * int    dir_file_remove(const char* dirpath, const char* name)
  *
  * int    dir_file_rename(const char* dirpath, const char* old_name, const char* new_name)
+ *
+ * size_t dir_file_write_atomic(const void* pointer, size_t size, const char* dirpath, const char* name)
+ *
+ * size_t dir_file_write_replace(const void* pointer, size_t size, const char* dirpath, const char* name)
+ *
+ * void*  dir_file_map(size_t* size, const char* dirpath, const char* name)
  */
 
 /*
@@ -73,6 +87,14 @@ extern int    file_remove(const char* filepath);
 
 extern int    file_rename(const char* old_filepath, const char* new_filepath);
 
+extern size_t file_write_atomic(const void* pointer, size_t size, const char* filepath);
+
+extern size_t file_write_replace(const void* pointer, size_t size, const char* filepath);
+
+extern void*  file_map(size_t* size, const char* filepath);
+
+extern void   file_unmap(void* pointer, size_t size);
+
 
 extern size_t file_lines_read(char*** lines, size_t size, const char* filepath);
 
@@ -98,6 +120,12 @@ extern int    dir_file_remove(const char* dirpath, const char* name);
 
 extern int    dir_file_rename(const char* dirpath, const char* old_name, const char* new_name);
 
+extern size_t dir_file_write_atomic(const void* pointer, size_t size, const char* dirpath, const char* name);
+
+extern size_t dir_file_write_replace(const void* pointer, size_t size, const char* dirpath, const char* name);
+
+extern void*  dir_file_map(size_t* size, const char* dirpath, const char* name);
+
 #endif // FILE_H
 
 /*
@@ -110,10 +138,14 @@ extern int    dir_file_rename(const char* dirpath, const char* old_name, const c
 
 #include <stdio.h>
 #include <string.h>
+#include <stdbool.h>
 #include <dirent.h>
 #include <stdlib.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
 
 /*
  * Get number of bytes in file
@@ -223,6 +255,184 @@ size_t file_write(const void* pointer, size_t size, const char* filepath)
   return write_size;
 }
 
+/*
+ * Sync the directory of file to disk, so that a rename in it is kept
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to open or sync the directory
+ */
+static inline int file_dir_sync(const char* filepath)
+{
+  const char* slash = strrchr(filepath, '/');
+
+  // The root directory keeps its slash
+  size_t length = !slash ? 0 : (slash == filepath) ? 1 : (size_t) (slash - filepath);
+
+  char dirpath[length + 2];
+
+  if (length > 0)
+  {
+    memcpy(dirpath, filepath, length);
+
+    dirpath[length] = '\0';
+  }
+  else strcpy(dirpath, ".");
+
+  int fd = open(dirpath, O_RDONLY | O_DIRECTORY);
+
+  if (fd == -1) return 1;
+
+  int status = fsync(fd);
+
+  close(fd);
+
+  return (status == 0) ? 0 : 1;
+}
+
+/*
+ * Write a number of bytes to a temporary file, which replaces the file
+ *
+ * If is_sync is true, the bytes are on disk before the file is replaced,
+ * and the directory is synced after, so the replacement is on disk too
+ *
+ * RETURN (size_t write_size)
+ * - 0  | Failed to write file or bad pointer
+ * - >0 | The number of written bytes
+ */
+static inline size_t file_temp_write(const void* pointer, size_t size, const char* filepath, bool is_sync)
+{
+  if (!pointer) return 0;
+
+  char temp_filepath[strlen(filepath) + 5];
+
+  sprintf(temp_filepath, "%s.tmp", filepath);
+
+  FILE* stream = fopen(temp_filepath, "wb");
+
+  if (!stream) return 0;
+
+  size_t write_size = fwrite(pointer, 1, size, stream);
+
+  if (write_size != size || fflush(stream) != 0 || (is_sync && fsync(fileno(stream)) != 0))
+  {
+    fclose(stream);
+
+    remove(temp_filepath);
+
+    return 0;
+  }
+
+  fclose(stream);
+
+  if (rename(temp_filepath, filepath) != 0)
+  {
+    remove(temp_filepath);
+
+    return 0;
+  }
+
+  if (is_sync && file_dir_sync(filepath) != 0)
+  {
+    return 0;
+  }
+
+  return write_size;
+}
+
+/*
+ * Write a number of bytes to file, so that the file either has
+ * the old content or all of the new content, even after a crash
+ *
+ * The bytes are written to a temporary file, which replaces the file.
+ * Both the file and its directory are synced, so once this returns,
+ * the new content is kept after a crash
+ *
+ * PARAMS
+ * - const void* pointer  | Pointer to memory to read from
+ * - size_t      size     | Number of bytes to write
+ * - const char* filepath | Path to file
+ *
+ * RETURN (size_t write_size)
+ * - 0  | Failed to write file or bad pointer
+ * - >0 | The number of written bytes
+ */
+size_t file_write_atomic(const void* pointer, size_t size, const char* filepath)
+{
+  return file_temp_write(pointer, size, filepath, true);
+}
+
+/*
+ * Write a number of bytes to file, replacing it like file_write_atomic,
+ * but without waiting for the bytes to reach the disk
+ *
+ * Other processes either see the old content or all of the new content,
+ * but after a power loss the file might be empty or cut short
+ *
+ * PARAMS
+ * - const void* pointer  | Pointer to memory to read from
+ * - size_t      size     | Number of bytes to write
+ * - const char* filepath | Path to file
+ *
+ * RETURN (size_t write_size)
+ * - 0  | Failed to write file or bad pointer
+ * - >0 | The number of written bytes
+ */
+size_t file_write_replace(const void* pointer, size_t size, const char* filepath)
+{
+  return file_temp_write(pointer, size, filepath, false);
+}
+
+/*
+ * Map file to memory, read only
+ *
+ * PARAMS
+ * - size_t*     size     | Number of mapped bytes
+ * - const char* filepath | Path to file
+ *
+ * RETURN (void* pointer)
+ * - NULL | Failed to map file, or file is empty
+ *
+ * Note: Remember to unmap the memory with file_unmap
+ */
+void* file_map(size_t* size, const char* filepath)
+{
+  int fd = open(filepath, O_RDONLY);
+
+  if (fd == -1) return NULL;
+
+  struct stat file_stat;
+
+  if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0)
+  {
+    close(fd);
+
+    return NULL;
+  }
+
+  void* pointer = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+  close(fd);
+
+  if (pointer == MAP_FAILED) return NULL;
+
+  *size = file_stat.st_size;
+
+  return pointer;
+}
+
+/*
+ * Unmap file mapped with file_map
+ *
+ * PARAMS
+ * - void*  pointer | Pointer to mapped memory
+ * - size_t size    | Number of mapped bytes
+ */
+void file_unmap(void* pointer, size_t size)
+{
+  if (pointer) munmap(pointer, size);
+}
+
 /*
  * Free lines read from file
  *
@@ -389,6 +599,76 @@ size_t dir_file_write(const void* pointer, size_t size, const char* dirpath, con
   return file_write(pointer, size, filepath);
 }
 
+/*
+ * Write to file inside directory, atomically like file_write_atomic
+ *
+ * PARAMS
+ * - const void* pointer | Pointer to memory to read from
+ * - size_t      size    | Number of bytes to write
+ * - const char* dirpath | Path to directory
+ * - const char* name    | Name of file
+ *
+ * RETURN (size_t write_size)
+ * - 0  | Failed to write file or bad pointer
+ * - >0 | The number of written bytes
+ */
+size_t dir_file_write_atomic(const void* pointer, size_t size, const char* dirpath, const char* name)
+{
+  size_t path_size = strlen(dirpath) + 1 + strlen(name);
+
+  char filepath[path_size + 1];
+
+  sprintf(filepath, "%s/%s", dirpath, name);
+
+  return file_write_atomic(pointer, size, filepath);
+}
+
+/*
+ * Write to file inside directory, replacing it like file_write_replace
+ *
+ * PARAMS
+ * - const void* pointer | Pointer to memory to read from
+ * - size_t      size    | Number of bytes to write
+ * - const char* dirpath | Path to directory
+ * - const char* name    | Name of file
+ *
+ * RETURN (size_t write_size)
+ * - 0  | Failed to write file or bad pointer
+ * - >0 | The number of written bytes
+ */
+size_t dir_file_write_replace(const void* pointer, size_t size, const char* dirpath, const char* name)
+{
+  size_t path_size = strlen(dirpath) + 1 + strlen(name);
+
+  char filepath[path_size + 1];
+
+  sprintf(filepath, "%s/%s", dirpath, name);
+
+  return file_write_replace(pointer, size, filepath);
+}
+
+/*
+ * Map file inside directory to memory, like file_map
+ *
+ * PARAMS
+ * - size_t*     size    | Number of mapped bytes
+ * - const char* dirpath | Path to directory
+ * - const char* name    | Name of file
+ *
+ * RETURN (void* pointer)
+ * - NULL | Failed to map file, or file is empty
+ */
+void* dir_file_map(size_t* size, const char* dirpath, const char* name)
+{
+  size_t path_size = strlen(dirpath) + 1 + strlen(name);
+
+  char filepath[path_size + 1];
+
+  sprintf(filepath, "%s/%s", dirpath, name);
+
+  return file_map(size, filepath);
+}
+
 /*
  * Get size of file inside directory
  *
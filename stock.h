@@ -19,79 +19,315 @@
 #define MIN(a, b) (((a) > (b)) ? (b) : (a))
 
 /*
- * Stock value struct
+ * Stock value struct, one value of the stock values columns
  */
 typedef struct stock_value_t
 {
-  int    time;
-  int    volume;
-  double high;
-  double low;
-  double close;
-  double open;
+  int64_t time;
+  int64_t volume;
+  double  high;
+  double  low;
+  double  close;
+  double  open;
 } stock_value_t;
 
+/*
+ * Stock values, stored as one contiguous column per field
+ *
+ * Scans only read the columns they need, like high and low for the
+ * min and max, and the columns vectorize cleanly
+ *
+ * All columns share one allocation, which starts at the time column
+ */
+typedef struct stock_values_t
+{
+  int64_t* time;
+  int64_t* volume;
+  double*  high;
+  double*  low;
+  double*  close;
+  double*  open;
+  size_t   count;
+  size_t   capacity;
+} stock_values_t;
+
+#define STOCK_PYRAMID_LEVELS 64
+
+/*
+ * Pyramid of the highs and lows of stock values
+ *
+ * Every node of a level holds the high and low of two nodes of the
+ * level below, and the level below the first level is the values
+ *
+ * Level 0 is the values themselves and is not stored
+ *
+ * The nodes are laid out by position, which is the index of the value
+ * plus offset, so dropped values only move the offset and appended
+ * values only extend the nodes, until the positions run out
+ */
+typedef struct stock_pyramid_t
+{
+  double* highs;                         // Nodes of every level, level after level
+  double* lows;
+  size_t  starts[STOCK_PYRAMID_LEVELS];  // Index of the first node of level
+  size_t  level_count;
+  size_t  node_count;
+  size_t  count;                         // Number of values in the pyramid
+  size_t  offset;                        // Position of the first value
+  size_t  capacity;                      // Number of positions
+} stock_pyramid_t;
+
+/*
+ * Technical indicators, drawn over the chart
+ */
+typedef enum stock_indicator_t
+{
+  STOCK_INDICATOR_SMA,       // Simple Moving Average
+  STOCK_INDICATOR_EMA,       // Exponential Moving Average
+  STOCK_INDICATOR_BOLLINGER, // Bollinger Bands
+  STOCK_INDICATOR_RSI,       // Relative Strength Index
+  STOCK_INDICATOR_VWAP,      // Volume Weighted Average Price
+  STOCK_INDICATOR_DONCHIAN,  // Donchian Channel
+  STOCK_INDICATOR_COUNT
+} stock_indicator_t;
+
+/*
+ * Lines of the indicators, every indicator has one or two lines
+ */
+typedef enum stock_line_t
+{
+  STOCK_LINE_SMA,
+  STOCK_LINE_EMA,
+  STOCK_LINE_BOLLINGER_UPPER,
+  STOCK_LINE_BOLLINGER_LOWER,
+  STOCK_LINE_RSI,
+  STOCK_LINE_VWAP,
+  STOCK_LINE_DONCHIAN_UPPER,
+  STOCK_LINE_DONCHIAN_LOWER,
+  STOCK_LINE_COUNT
+} stock_line_t;
+
+/*
+ * Indicator lines, one column per line
+ *
+ * A line is NAN where its indicator does not have enough values yet
+ *
+ * The state columns are only used for the lines of stock values, to
+ * continue the indicators from any value when values are appended
+ */
+typedef struct stock_lines_t
+{
+  double* lines[STOCK_LINE_COUNT];
+  double* gains;   // RSI average gain
+  double* losses;  // RSI average loss
+  double* prices;  // VWAP sum of price times volume
+  double* volumes; // VWAP sum of volume
+  size_t  count;
+  size_t  capacity;
+  int     mask;    // Indicators that the lines are calculated for
+} stock_lines_t;
+
+/*
+ * Market data of the current trading day, from the response meta data
+ *
+ * Fields that are missing in the response are zero
+ */
+typedef struct stock_market_t
+{
+  int64_t start; // Regular Trading Start Time
+  int64_t end;   // Regular Trading End   Time
+  double  price; // Regular Market Price
+  double  high;  // Regular Market Day High
+  double  low;   // Regular Market Day Low
+} stock_market_t;
+
+/*
+ * Id of an interned string, 0 is no string
+ */
+typedef int stock_id_t;
+
 /*
  * Stock struct
+ *
+ * The strings are interned, get them with stock_string_get
  */
 typedef struct stock_t
 {
-  char*          symbol;
-  char*          name;
-  char*          exchange;
-  char*          range;
-  char*          interval;
-  char*          currency;
+  stock_id_t     symbol;
+  stock_id_t     name;
+  stock_id_t     exchange;
+  stock_id_t     range;
+  stock_id_t     interval;
+  stock_id_t     currency;
   int            volume; // Regular Market Volume
 
-  int            start;  // Today Start Time
-  int            end;    // Today End   Time
+  int64_t        start;  // Today Start Time
+  int64_t        end;    // Today End   Time
   double         open;   // Today Open  Price
   double         close;  // Today Close Price
   double         high;   // Today High  Price
   double         low;    // Today Low   Price
 
-  stock_value_t* values;
-  size_t         value_count;
-
-  stock_value_t* _values;
-  size_t         _value_count;
-  int            _start;
-  int            _end;
+  stock_market_t market;
+
+  stock_values_t values;
+
+  stock_values_t _values;    // Resized by the chart that shows the stock
+  stock_pyramid_t _pyramid; // Built from values when resizing
+  stock_lines_t  _indicators; // Indicator lines of values
+  stock_lines_t  _lines;      // Indicator lines of _values
+  size_t         _view_first; // First value of the view
+  size_t         _view_end;   // End of the view, 0 is the end of the values
+  unsigned long  _resize_version; // Version, view and count of the last resize
+  size_t         _resize_first;
+  size_t         _resize_end;
+  size_t         _resize_count;
+  int64_t        _resize_step;   // Seconds of every group, 0 for COUNT
+  size_t         _resize_stable; // Values that have not changed since
+  int            _resize_mask;   // Indicators that were resized
+  int64_t        _start;
+  int64_t        _end;
   double         _open;
   double         _close;
   double         _high;
   double         _low;
+
+  int64_t        fetch_time; // Time of the last fetch
+  bool           is_dirty;   // Changed since it was written to the disk cache
+
+  unsigned long  version; // Incremented when the data is replaced
 } stock_t;
 
+/*
+ * How stock_resize groups the values
+ *
+ * COUNT - Groups of the same number of values
+ * TIME  - Groups of the same duration, aligned to the clock
+ */
+typedef enum stock_resize_mode_t
+{
+  STOCK_RESIZE_COUNT,
+  STOCK_RESIZE_TIME,
+} stock_resize_mode_t;
+
+/*
+ * Where the stock data is fetched from
+ *
+ * LIVE   - Yahoo Finance
+ * RECORD - Yahoo Finance, saving every response in a directory
+ * REPLAY - The saved responses in a directory, with optional latency
+ */
+typedef enum stock_mode_t
+{
+  STOCK_MODE_LIVE,
+  STOCK_MODE_RECORD,
+  STOCK_MODE_REPLAY,
+} stock_mode_t;
+
 /*
  * Function declarations
  */
 
+extern int      stock_init(void);
+
+extern void     stock_quit(void);
+
+extern stock_id_t stock_string_id_get(const char* string);
+
+extern const char* stock_string_get(stock_id_t id);
+
 extern stock_t* stock_create(char* symbol);
 
+extern stock_t* stock_create_start(char* symbol);
+
+extern int      stock_backend_set(stock_mode_t mode, const char* dir, int latency);
+
+extern size_t   stock_create_many(stock_t** stocks, char** symbols, size_t count, size_t limit);
+
 extern int      stock_zoom(stock_t* stock, char* range);
 
+extern int      stock_zoom_start(stock_t* stock, char* range);
+
+extern const char* stock_zoom_range_get(stock_t* stock);
+
+extern int      stock_refine_start(stock_t* stock);
+
+extern void     stock_columns_set(size_t count);
+
+extern void     stock_prefetch_start(stock_t* stock);
+
+extern void     stock_cache_size_set(size_t size);
+
+extern int      stock_disk_dir_set(const char* dir);
+
 extern int      stock_resize(stock_t* stock, size_t count);
 
+extern void     stock_resize_mode_set(stock_resize_mode_t mode);
+
+extern stock_resize_mode_t stock_resize_mode_get(void);
+
+extern void     stock_indicators_set(int mask);
+
+extern int      stock_indicators_get(void);
+
+extern stock_value_t stock_value_get(const stock_values_t* values, size_t index);
+
+extern int      stock_range_get(stock_t* stock, stock_value_t* value, size_t first, size_t end);
+
+extern int      stock_view_set(stock_t* stock, size_t first, size_t end);
+
+extern int      stock_view_time_set(stock_t* stock, int64_t start, int64_t end);
+
+extern void     stock_view_reset(stock_t* stock);
+
+extern int      stock_view_zoom(stock_t* stock, double factor);
+
+extern int      stock_view_pan(stock_t* stock, double fraction);
+
 extern int      stock_update(stock_t* stock);
 
+extern int      stock_update_start(stock_t* stock);
+
 extern void     stock_free(stock_t** stock);
 
+extern int      stock_poll_add(stock_t* stock);
+
+extern void     stock_poll_remove(stock_t* stock);
+
+extern void     stock_poll_delay_set(int seconds);
+
+extern size_t   stock_async_run(stock_t** stocks, size_t count);
+
 #endif // STOCK_H
 
 #ifdef STOCK_IMPLEMENT
 
+#include <time.h>
+#include <math.h>
+#include <errno.h>
+#include <stdint.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
 #include <curl/curl.h>
 #include <json-c/json.h>
 
+#if defined(__x86_64__) && defined(__GNUC__)
+#define STOCK_SIMD
+#include <immintrin.h>
+#endif
+
 /*
- * Stock ranges and corresponding intervals
+ * Stock ranges, and the intervals of yahoo from the finest to the
+ * coarsest, with the longest range in days each interval can be
+ * fetched for, 0 for any range
  */
 
 const char* STOCK_RANGES[]    = { "1d", "1wk", "1mo", "1y", "max" };
 
-const char* STOCK_INTERVALS[] = { "1m", "15m", "30m", "1h", "1d" };
+const char* STOCK_INTERVALS[] = { "1m", "2m", "5m", "15m", "30m", "60m", "90m", "1d", "5d", "1wk", "1mo", "3mo" };
+
+const int STOCK_INTERVAL_DAYS[] = { 7, 60, 60, 60, 60, 730, 730, 0, 0, 0, 0, 0 };
 
 #define STOCK_RANGE_COUNT    (sizeof(STOCK_RANGES)    / sizeof(char*))
 
@@ -113,809 +349,7303 @@ static inline ssize_t stock_range_index_get(const char* range)
   return -1;
 }
 
+#define STOCK_DAY_SECONDS (24 * 60 * 60)
+
 /*
- * Get stock interval string of index
+ * Get number of seconds of interval or range string, like 15m, 1h or 1y
+ *
+ * RETURN (int64_t seconds)
+ * - 0  | Bad interval
+ * - >0 | Seconds of interval
  */
-static inline const char* stock_interval_get(size_t index)
+static inline int64_t stock_interval_seconds_get(const char* interval)
 {
-  if (index >= 0 && index < STOCK_INTERVAL_COUNT)
+  char* unit;
+
+  long count = strtol(interval, &unit, 10);
+
+  if (count <= 0)
   {
-    return STOCK_INTERVALS[index];
+    return 0;
   }
 
-  return NULL;
+  if (strcmp(unit, "m")  == 0) return count * 60;
+  if (strcmp(unit, "h")  == 0) return count * 60 * 60;
+  if (strcmp(unit, "d")  == 0) return count * STOCK_DAY_SECONDS;
+  if (strcmp(unit, "wk") == 0) return count * STOCK_DAY_SECONDS * 7;
+  if (strcmp(unit, "mo") == 0) return count * STOCK_DAY_SECONDS * 30;
+  if (strcmp(unit, "y")  == 0) return count * STOCK_DAY_SECONDS * 365;
+
+  return 0;
 }
 
+#define STOCK_COLUMNS_DEFAULT 128
+
 /*
- * Get interval that corresponds to range
+ * Number of columns of the chart, that fetched ranges should fill
  */
-static inline const char* stock_range_interval_get(const char* range)
-{
-  ssize_t index = stock_range_index_get(range);
+static size_t stock_columns = STOCK_COLUMNS_DEFAULT;
 
-  if (index == -1)
-  {
-    return NULL;
-  }
-  
-  return stock_interval_get(index);
+/*
+ * Set number of columns of the chart, which decides the intervals that
+ * ranges are fetched with from now on
+ */
+void stock_columns_set(size_t count)
+{
+  stock_columns = MAX(count, 1);
 }
 
+#define STOCK_SESSION_SECONDS (6 * 60 * 60 + 30 * 60)
+
+#define STOCK_WEEK_SECONDS (7 * STOCK_DAY_SECONDS)
+
 /*
- * Calculate stock start, end, open, close, high and low for 1 day
+ * Estimate number of candles of interval in span seconds
+ *
+ * Markets are assumed to only be open for a regular session on weekdays,
+ * so markets that are open for longer get more candles than estimated
  */
-static inline int stock_meta_calc(stock_t* stock)
+static inline int64_t stock_candle_count_get(int64_t span, int64_t interval)
 {
-  if (stock->value_count <= 0)
+  int64_t days = (span <= STOCK_DAY_SECONDS) ? 1 : (span / STOCK_DAY_SECONDS * 5 / 7);
+
+  if (interval < STOCK_DAY_SECONDS)
   {
-    return 1;
+    return days * STOCK_SESSION_SECONDS / interval;
   }
 
-  stock_value_t value = stock->values[stock->value_count - 1];
+  if (interval < STOCK_WEEK_SECONDS)
+  {
+    return days * STOCK_DAY_SECONDS / interval;
+  }
+
+  return span / interval;
+}
+
+/*
+ * Span that max is assumed to have when its interval is picked
+ *
+ * Most symbols have a shorter history than the oldest indices, so the
+ * span is on the short side. Then the picked interval has at least a
+ * candle for every column for most symbols, instead of only for the
+ * oldest ones, and it only has to be refined for young symbols
+ */
+#define STOCK_MAX_SPAN (10 * 365 * STOCK_DAY_SECONDS)
 
-  stock->end   = value.time;
-  stock->close = value.close;
+/*
+ * Get the coarsest interval that still has a candle for every column
+ * of the chart in span seconds of range
+ *
+ * Only intervals that yahoo has for the whole range, and that are
+ * shorter than the range, are picked. If none of them is fine enough,
+ * the finest of them is picked
+ *
+ * RETURN (size_t index)
+ * - STOCK_INTERVAL_COUNT | No interval for range
+ */
+static inline size_t stock_interval_index_pick(const char* range, int64_t span)
+{
+  int64_t range_seconds = stock_interval_seconds_get(range); // 0 for max
 
-  stock->high = value.high;
-  stock->low  = value.low;
+  size_t finest = STOCK_INTERVAL_COUNT;
 
-  for (size_t index = stock->value_count; index-- > 0;)
+  for (size_t index = STOCK_INTERVAL_COUNT; index-- > 0;)
   {
-    value = stock->values[index];
+    int64_t seconds = stock_interval_seconds_get(STOCK_INTERVALS[index]);
+
+    int64_t days = STOCK_INTERVAL_DAYS[index];
+
+    if ((range_seconds > 0 && seconds >= range_seconds) ||
+        (days > 0 && (range_seconds == 0 || range_seconds > days * STOCK_DAY_SECONDS)))
+    {
+      continue;
+    }
 
-    stock->high = MAX(stock->high, value.high);
-    stock->low  = MIN(stock->low,  value.low);
+    if (stock_candle_count_get(span, seconds) >= stock_columns)
+    {
+      return index;
+    }
 
-    stock->start = value.time;
-    stock->open  = value.open;
+    finest = index;
   }
 
-  return 0;
+  return finest;
 }
 
 /*
- * Calculate stock _start, _end, _open, _close, _high and _low values
+ * Get interval to fetch range with, that fills the columns of the chart
+ *
+ * The span of max is not known until it is fetched, so it is assumed to
+ * be STOCK_MAX_SPAN, and refined with stock_refine_start if it is shorter
+ *
+ * RETURN (const char* interval)
+ * - NULL | Bad range
  */
-static inline int stock_values_calc(stock_t* stock)
+static inline const char* stock_range_interval_get(const char* range)
 {
-  if (stock->_value_count <= 0)
+  if (!range || stock_range_index_get(range) == -1)
   {
-    return 1;
+    return NULL;
   }
 
-  stock_value_t value = stock->_values[stock->_value_count - 1];
+  int64_t span = stock_interval_seconds_get(range);
 
-  stock->_end   = value.time;
-  stock->_close = value.close;
+  size_t index = stock_interval_index_pick(range, (span > 0) ? span : STOCK_MAX_SPAN);
 
-  stock->_high = value.high;
-  stock->_low  = value.low;
+  return (index < STOCK_INTERVAL_COUNT) ? STOCK_INTERVALS[index] : NULL;
+}
 
-  for (size_t index = stock->_value_count; index-- > 0;)
-  {
-    value = stock->_values[index];
+#define STOCK_STRINGS_SLOTS 64
+
+/*
+ * Interned strings, shared by all stocks
+ *
+ * Every distinct symbol, name, exchange, currency, range and interval
+ * is stored once, and stocks only hold the ids of the strings. The
+ * strings that no stock holds anymore are removed by stock_strings_sweep,
+ * and their ids are used again
+ *
+ * strings     - string of every id, id 0 is no string, NULL if removed
+ * slots       - open addressing hash table of ids, 0 is an empty slot
+ * frees       - removed ids, used before new ids
+ * live_count  - strings that are not removed
+ * sweep_count - live strings after the last sweep
+ */
+typedef struct stock_strings_t
+{
+  char**      strings;
+  size_t      count;
+  size_t      capacity;
+  stock_id_t* slots;
+  size_t      slot_count;
+  stock_id_t* frees;
+  size_t      free_count;
+  size_t      live_count;
+  size_t      sweep_count;
+} stock_strings_t;
+
+static stock_strings_t stock_strings = { 0 };
 
-    stock->_high = MAX(stock->_high, value.high);
-    stock->_low  = MIN(stock->_low,  value.low);
+/*
+ * FNV-1a hash of size bytes of string
+ */
+static inline uint32_t stock_string_hash(const char* string, size_t size)
+{
+  uint32_t hash = 2166136261u;
 
-    stock->_start = value.time;
-    stock->_open  = value.open;
+  for (size_t index = 0; index < size; index++)
+  {
+    hash = (hash ^ (uint8_t) string[index]) * 16777619u;
   }
 
-  return 0;
+  return hash;
 }
 
 /*
- * Resize stock values and store them in _values
+ * Set the number of slots of the hash table, inserting all ids again
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate memory
  */
-int stock_resize(stock_t* stock, size_t count)
+static inline int stock_strings_slots_set(size_t slot_count)
 {
-  if (count > stock->value_count)
+  stock_id_t* slots = calloc(slot_count, sizeof(stock_id_t));
+
+  if (!slots)
   {
     return 1;
   }
 
-  size_t group_size = stock->value_count / count;
+  for (size_t id = 1; id < stock_strings.count; id++)
+  {
+    const char* string = stock_strings.strings[id];
+
+    if (!string) continue;
+
+    size_t slot = stock_string_hash(string, strlen(string)) & (slot_count - 1);
+
+    while (slots[slot])
+    {
+      slot = (slot + 1) & (slot_count - 1);
+    }
+
+    slots[slot] = id;
+  }
+
+  free(stock_strings.slots);
 
-  size_t spill = stock->value_count - count * group_size;
+  stock_strings.slots      = slots;
+  stock_strings.slot_count = slot_count;
 
-  stock_value_t* values = malloc(sizeof(stock_value_t) * count);
+  return 0;
+}
 
-  if (!values)
+/*
+ * Get id of size bytes of string, interning the string if it is new
+ *
+ * RETURN (stock_id_t id)
+ * - 0  | No string, or failed to allocate memory
+ * - >0 | Id of string
+ */
+static inline stock_id_t stock_string_size_id_get(const char* string, size_t size)
+{
+  if (!string)
   {
-    return 2;
+    return 0;
   }
 
-  size_t value_index = 0;
-  
-  for (size_t group_index = 0; group_index < count; group_index++)
+  size = strnlen(string, size);
+
+  // Keep the hash table at most half full, id 0 is never inserted
+  if (MAX(stock_strings.count, 1) * 2 >= stock_strings.slot_count &&
+      stock_strings_slots_set(MAX(stock_strings.slot_count * 2, STOCK_STRINGS_SLOTS)) != 0)
   {
-    // Get first value of group
-    stock_value_t group_value = stock->values[value_index++];
+    return 0;
+  }
 
-    size_t curr_size = (group_index < spill) ? group_size + 1 : group_size;
+  size_t mask = stock_strings.slot_count - 1;
 
-    // Merge middle values of group
-    for (size_t index = 1; index < (curr_size - 1); index++)
-    {
-      stock_value_t value = stock->values[value_index++];
+  size_t slot = stock_string_hash(string, size) & mask;
 
-      group_value.high = MAX(group_value.high, value.high);
-      group_value.low  = MIN(group_value.low,  value.low);
-    }
-  
-    // Merge last value of group
-    if (curr_size > 1)
+  for (; stock_strings.slots[slot]; slot = (slot + 1) & mask)
+  {
+    const char* other = stock_strings.strings[stock_strings.slots[slot]];
+
+    // A removed id stays in its slot until the slots are set again
+    if (other && strncmp(other, string, size) == 0 && other[size] == '\0')
     {
-      stock_value_t value = stock->values[value_index++];
+      return stock_strings.slots[slot];
+    }
+  }
+
+  bool is_free = (stock_strings.free_count > 0);
+
+  size_t id = is_free ? stock_strings.frees[stock_strings.free_count - 1] : MAX(stock_strings.count, 1);
+
+  if (id + 1 > stock_strings.capacity)
+  {
+    size_t capacity = MAX(stock_strings.capacity * 2, STOCK_STRINGS_SLOTS);
 
-      group_value.close  = value.close;
-      group_value.time   = value.time;
-      group_value.volume = value.volume;
+    char** strings = realloc(stock_strings.strings, sizeof(char*) * capacity);
 
-      group_value.high = MAX(group_value.high, value.high);
-      group_value.low  = MIN(group_value.low,  value.low);
+    if (!strings)
+    {
+      return 0;
     }
 
-    values[group_index] = group_value;
+    strings[0] = NULL;
+
+    stock_strings.strings  = strings;
+    stock_strings.capacity = capacity;
   }
 
-  free(stock->_values);
+  char* copy = strndup(string, size);
+
+  if (!copy)
+  {
+    return 0;
+  }
 
-  stock->_values = values;
+  stock_strings.strings[id] = copy;
 
-  stock->_value_count = count;
+  stock_strings.slots[slot] = id;
 
-  if (stock_values_calc(stock) != 0)
+  if (is_free)
   {
-    // Maybe use copy stock and then return error here
+    stock_strings.free_count--;
   }
+  else stock_strings.count = id + 1;
 
-  return 0;
+  stock_strings.live_count++;
+
+  return id;
 }
 
 /*
- * Function for curl to write response
+ * Get id of string, interning the string if it is new
+ *
+ * RETURN (stock_id_t id)
+ * - 0  | No string, or failed to allocate memory
+ * - >0 | Id of string
  */
-static inline size_t stock_response_write(void* ptr, size_t size, size_t nmemb, char* response)
+stock_id_t stock_string_id_get(const char* string)
 {
-  size_t total_size = size * nmemb;
+  return string ? stock_string_size_id_get(string, strlen(string)) : 0;
+}
 
-  strncat(response, ptr, total_size);
+/*
+ * Get interned string of id
+ *
+ * RETURN (const char* string)
+ * - NULL | No string
+ */
+const char* stock_string_get(stock_id_t id)
+{
+  if (id > 0 && id < stock_strings.count)
+  {
+    return stock_strings.strings[id];
+  }
 
-  return total_size;
+  return NULL;
 }
 
-#define STOCK_URL_SIZE 256
-#define STOCK_URL_BASE "https://query1.finance.yahoo.com/v8/finance/chart/"
+/*
+ * Check if range is the 1d range, the range of the 1d meta data
+ */
+static inline bool stock_range_is_day(stock_id_t range)
+{
+  return range != 0 && range == stock_string_id_get("1d");
+}
 
 /*
- * Create url for fetching stock data
+ * Free all interned strings
  */
-static inline char* stock_url_create(char* symbol, char* range, char* interval)
+static inline void stock_strings_free(void)
 {
-  if (!symbol)
+  for (size_t id = 1; id < stock_strings.count; id++)
   {
-    return NULL;
+    free(stock_strings.strings[id]);
   }
 
-  char* url = malloc(sizeof(char) * STOCK_URL_SIZE);
+  free(stock_strings.strings);
 
-  if (!url)
+  free(stock_strings.slots);
+
+  free(stock_strings.frees);
+
+  stock_strings = (stock_strings_t) { 0 };
+}
+
+/*
+ * Bytes of one value in all columns
+ */
+#define STOCK_VALUE_SIZE (2 * sizeof(int64_t) + 4 * sizeof(double))
+
+/*
+ * Make room for at least capacity values, keeping the current values
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate memory
+ */
+static inline int stock_values_reserve(stock_values_t* values, size_t capacity)
+{
+  if (capacity <= values->capacity)
   {
-    return NULL;
+    return 0;
   }
 
-  if (sprintf(url,"%s%s?", STOCK_URL_BASE, symbol) < 0)
+  if (capacity > SIZE_MAX / STOCK_VALUE_SIZE)
   {
-    free(url);
-
-    return NULL;
+    return 1;
   }
 
-  if (range && sprintf(url + strlen(url), "range=%s&", range) < 0)
-  {
-    free(url);
+  char* block = malloc(STOCK_VALUE_SIZE * capacity);
 
-    return NULL;
+  if (!block)
+  {
+    return 1;
   }
 
-  if (interval && sprintf(url + strlen(url), "interval=%s&", interval) < 0)
+  stock_values_t new_values = (stock_values_t)
   {
-    free(url);
+    .time     = (int64_t*) (block),
+    .volume   = (int64_t*) (block + sizeof(int64_t) * capacity),
+    .high     = (double*)  (block + sizeof(int64_t) * capacity * 2),
+    .low      = (double*)  (block + sizeof(int64_t) * capacity * 2 + sizeof(double) * capacity),
+    .close    = (double*)  (block + sizeof(int64_t) * capacity * 2 + sizeof(double) * capacity * 2),
+    .open     = (double*)  (block + sizeof(int64_t) * capacity * 2 + sizeof(double) * capacity * 3),
+    .count    = values->count,
+    .capacity = capacity,
+  };
 
-    return NULL;
+  if (values->count > 0)
+  {
+    memcpy(new_values.time,   values->time,   sizeof(int64_t) * values->count);
+    memcpy(new_values.volume, values->volume, sizeof(int64_t) * values->count);
+    memcpy(new_values.high,   values->high,   sizeof(double)  * values->count);
+    memcpy(new_values.low,    values->low,    sizeof(double)  * values->count);
+    memcpy(new_values.close,  values->close,  sizeof(double)  * values->count);
+    memcpy(new_values.open,   values->open,   sizeof(double)  * values->count);
   }
 
-  return url;
-}
+  free(values->time);
 
-#define STOCK_RESPONSE_SIZE 1000000
+  *values = new_values;
 
-#define STOCK_CURL_HEADER "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/58.0.3029.110 Safari/537.3"
+  return 0;
+}
 
 /*
- * Get curl response for a stock
+ * Free the columns of values
  */
-static inline char* stock_response_get(char* symbol, char* range, char* interval)
+static inline void stock_values_free(stock_values_t* values)
 {
-  curl_global_init(CURL_GLOBAL_DEFAULT);
+  free(values->time);
 
-  CURL* curl = curl_easy_init();
-
-  if (!curl)
-  {
-    curl_global_cleanup();
+  *values = (stock_values_t) { 0 };
+}
 
-    return NULL;
-  }
-
-  char* response = malloc(sizeof(char) * STOCK_RESPONSE_SIZE);
+/*
+ * Move count values from src_index of src to dest_index of dest
+ *
+ * The values can be the same and the ranges can overlap
+ */
+static inline void stock_values_move(stock_values_t* dest, size_t dest_index, const stock_values_t* src, size_t src_index, size_t count)
+{
+  memmove(dest->time   + dest_index, src->time   + src_index, sizeof(int64_t) * count);
+  memmove(dest->volume + dest_index, src->volume + src_index, sizeof(int64_t) * count);
+  memmove(dest->high   + dest_index, src->high   + src_index, sizeof(double)  * count);
+  memmove(dest->low    + dest_index, src->low    + src_index, sizeof(double)  * count);
+  memmove(dest->close  + dest_index, src->close  + src_index, sizeof(double)  * count);
+  memmove(dest->open   + dest_index, src->open   + src_index, sizeof(double)  * count);
+}
 
-  if (!response)
+/*
+ * Get value at index of the columns of values
+ */
+stock_value_t stock_value_get(const stock_values_t* values, size_t index)
+{
+  return (stock_value_t)
   {
-    curl_global_cleanup();
+    .time   = values->time[index],
+    .volume = values->volume[index],
+    .high   = values->high[index],
+    .low    = values->low[index],
+    .close  = values->close[index],
+    .open   = values->open[index],
+  };
+}
 
-    return NULL;
-  }
+/*
+ * The min and max kernels use SSE2, which every x86-64 cpu has, or AVX2
+ * if the cpu supports it, and plain loops on other architectures
+ *
+ * Columns shorter than this are scanned with plain loops
+ */
+#define STOCK_SIMD_MIN 8
 
-  memset(response, '\0', sizeof(char) * STOCK_RESPONSE_SIZE);
+#ifdef STOCK_SIMD
 
-  char* url = stock_url_create(symbol, range, interval);
+/*
+ * Check if the cpu supports AVX2, only asking the cpu the first time
+ */
+static inline bool stock_simd_avx2_get(void)
+{
+  static int is_avx2 = -1;
 
-  if (!url)
+  if (is_avx2 == -1)
   {
-    free(response);
-
-    curl_global_cleanup();
+    __builtin_cpu_init();
 
-    return NULL;
+    is_avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
   }
 
-  curl_easy_setopt(curl, CURLOPT_URL, url);
-
-  curl_easy_setopt(curl, CURLOPT_USERAGENT, STOCK_CURL_HEADER);
-
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, stock_response_write);
+  return is_avx2;
+}
 
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+/*
+ * Get max of count numbers, 2 at a time
+ */
+static inline double stock_column_max_sse2(const double* column, size_t count)
+{
+  __m128d first  = _mm_loadu_pd(column);
+  __m128d second = first;
 
-  CURLcode res = curl_easy_perform(curl);
+  size_t index = 0;
 
+  // Two accumulators hide the latency of max
+  for (; index + 4 <= count; index += 4)
+  {
+    first  = _mm_max_pd(first,  _mm_loadu_pd(column + index));
+    second = _mm_max_pd(second, _mm_loadu_pd(column + index + 2));
+  }
 
-  curl_easy_cleanup(curl);
+  double lanes[2];
 
-  curl_global_cleanup();
+  _mm_storeu_pd(lanes, _mm_max_pd(first, second));
 
-  free(url);
+  double max = MAX(lanes[0], lanes[1]);
 
-  if (res == CURLE_OK)
+  for (; index < count; index++)
   {
-    return response;
+    max = MAX(max, column[index]);
   }
 
-  free(response);
-
-  return NULL;
+  return max;
 }
 
 /*
- * Parse stock name, either longName or shortName, or symbol
+ * Get min of count numbers, 2 at a time
  */
-static inline int stock_name_parse(stock_t* stock, struct json_object* meta)
+static inline double stock_column_min_sse2(const double* column, size_t count)
 {
-  struct json_object* name = json_object_object_get(meta, "longName");
+  __m128d first  = _mm_loadu_pd(column);
+  __m128d second = first;
 
-  if (name && json_object_is_type(name, json_type_string))
-  {
-    stock->name = strdup(json_object_get_string(name));
+  size_t index = 0;
 
-    return 0;
+  for (; index + 4 <= count; index += 4)
+  {
+    first  = _mm_min_pd(first,  _mm_loadu_pd(column + index));
+    second = _mm_min_pd(second, _mm_loadu_pd(column + index + 2));
   }
 
-  error_print("Missing 'longName' field: %s", stock->symbol);
+  double lanes[2];
 
+  _mm_storeu_pd(lanes, _mm_min_pd(first, second));
 
-  name = json_object_object_get(meta, "shortName");
+  double min = MIN(lanes[0], lanes[1]);
 
-  if (name && json_object_is_type(name, json_type_string))
+  for (; index < count; index++)
   {
-    stock->name = strdup(json_object_get_string(name));
+    min = MIN(min, column[index]);
+  }
 
-    return 0;
+  return min;
+}
+
+/*
+ * Get max of count numbers, 4 at a time
+ */
+__attribute__((target("avx2")))
+static inline double stock_column_max_avx2(const double* column, size_t count)
+{
+  __m256d first  = _mm256_loadu_pd(column);
+  __m256d second = first;
+
+  size_t index = 0;
+
+  for (; index + 8 <= count; index += 8)
+  {
+    first  = _mm256_max_pd(first,  _mm256_loadu_pd(column + index));
+    second = _mm256_max_pd(second, _mm256_loadu_pd(column + index + 4));
   }
 
-  error_print("Missing 'shortName' field: %s", stock->symbol);
+  double lanes[4];
 
+  _mm256_storeu_pd(lanes, _mm256_max_pd(first, second));
 
-  stock->name = strdup(stock->symbol);
+  double max = MAX(MAX(lanes[0], lanes[1]), MAX(lanes[2], lanes[3]));
 
-  return 1;
+  for (; index < count; index++)
+  {
+    max = MAX(max, column[index]);
+  }
+
+  return max;
 }
 
 /*
- * Parse stock meta data
+ * Get min of count numbers, 4 at a time
  */
-static inline int stock_meta_parse(stock_t* stock, struct json_object* result)
+__attribute__((target("avx2")))
+static inline double stock_column_min_avx2(const double* column, size_t count)
 {
-  struct json_object* meta = json_object_object_get(result, "meta");
+  __m256d first  = _mm256_loadu_pd(column);
+  __m256d second = first;
 
-  if (!meta)
-  {
-    error_print("Missing 'meta' field: %s", stock->symbol);
+  size_t index = 0;
 
-    return 1;
+  for (; index + 8 <= count; index += 8)
+  {
+    first  = _mm256_min_pd(first,  _mm256_loadu_pd(column + index));
+    second = _mm256_min_pd(second, _mm256_loadu_pd(column + index + 4));
   }
 
+  double lanes[4];
 
-  struct json_object* currency = json_object_object_get(meta, "currency");
+  _mm256_storeu_pd(lanes, _mm256_min_pd(first, second));
 
-  if (!currency || !json_object_is_type(currency, json_type_string))
-  {
-    error_print("Missing 'currency' field: %s", stock->symbol);
+  double min = MIN(MIN(lanes[0], lanes[1]), MIN(lanes[2], lanes[3]));
 
-    return 3;
+  for (; index < count; index++)
+  {
+    min = MIN(min, column[index]);
   }
 
-  stock->currency = strdup(json_object_get_string(currency));
+  return min;
+}
 
+#endif // STOCK_SIMD
 
-  if (stock_name_parse(stock, meta) != 0)
+/*
+ * Get max of count numbers, count has to be at least 1
+ */
+static inline double stock_column_max(const double* column, size_t count)
+{
+#ifdef STOCK_SIMD
+  if (count >= STOCK_SIMD_MIN)
   {
-    error_print("Failed to parse stock name");
+    return stock_simd_avx2_get() ?
+      stock_column_max_avx2(column, count) :
+      stock_column_max_sse2(column, count);
   }
+#endif
 
+  double max = column[0];
 
-  struct json_object* exchange = json_object_object_get(meta, "fullExchangeName");
-
-  if (!exchange || !json_object_is_type(exchange, json_type_string))
+  for (size_t index = 1; index < count; index++)
   {
-    error_print("Missing 'fullExchangeName' field: %s", stock->symbol);
+    max = MAX(max, column[index]);
   }
 
-  stock->exchange = strdup(json_object_get_string(exchange));
+  return max;
+}
 
+/*
+ * Get min of count numbers, count has to be at least 1
+ */
+static inline double stock_column_min(const double* column, size_t count)
+{
+#ifdef STOCK_SIMD
+  if (count >= STOCK_SIMD_MIN)
+  {
+    return stock_simd_avx2_get() ?
+      stock_column_min_avx2(column, count) :
+      stock_column_min_sse2(column, count);
+  }
+#endif
 
-  struct json_object* volume = json_object_object_get(meta, "regularMarketVolume");
+  double min = column[0];
 
-  if (!volume || !json_object_is_type(volume, json_type_int))
+  for (size_t index = 1; index < count; index++)
   {
-    error_print("Missing 'regularMarketVolume' field: %s", stock->symbol);
+    min = MIN(min, column[index]);
   }
 
-  stock->volume = json_object_get_int(volume);
-
-  return 0;
+  return min;
 }
 
 /*
- * Parse json objects for stock value
+ * Calculate stock start, end, open, close, high and low for 1 day
+ * from the candles of the current trading session and the market data
+ *
+ * This makes a separate 1d request unnecessary for intraday intervals
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Missing trading period or values
+ * - 2 | No candles of the current trading session
  */
-static inline int stock_value_parse(stock_value_t* value, struct json_object* time, struct json_object* volume, struct json_object* open, struct json_object* close, struct json_object* high, struct json_object* low)
+static inline int stock_market_calc(stock_t* stock)
 {
-  if (!time || !json_object_is_type(time, json_type_int))
+  stock_market_t market = stock->market;
+
+  const stock_values_t* values = &stock->values;
+
+  if (market.start == 0 || values->count == 0)
   {
     return 1;
   }
 
-  value->time = json_object_get_int(time);
-
+  size_t last = values->count - 1;
 
-  if (!volume || !json_object_is_type(volume, json_type_int))
+  if (values->time[last] < market.start)
   {
     return 2;
   }
 
-  value->volume = json_object_get_int(volume);
-
+  // Index of the first candle of the current trading session
+  size_t first = last;
 
-  if (!open || !json_object_is_type(open, json_type_double))
+  while (first > 0 && values->time[first - 1] >= market.start)
   {
-    return 3;
+    first--;
   }
 
-  value->open = json_object_get_double(open);
+  stock->end   = values->time[last];
+  stock->close = (market.price > 0) ? market.price : values->close[last];
 
+  stock->start = values->time[first];
+  stock->open  = values->open[first];
 
-  if (!close || !json_object_is_type(close, json_type_double))
-  {
-    return 4;
-  }
+  stock->high = stock_column_max(values->high + first, values->count - first);
+  stock->low  = stock_column_min(values->low  + first, values->count - first);
 
-  value->close = json_object_get_double(close);
+  if (market.high > 0) stock->high = market.high;
+  if (market.low  > 0) stock->low  = market.low;
 
+  return 0;
+}
 
-  if (!high || !json_object_is_type(high, json_type_double))
+/*
+ * Calculate stock start, end, open, close, high and low for 1 day
+ */
+static inline int stock_meta_calc(stock_t* stock)
+{
+  const stock_values_t* values = &stock->values;
+
+  if (values->count <= 0)
   {
-    return 5;
+    return 1;
   }
 
-  value->high = json_object_get_double(high);
+  size_t last = values->count - 1;
 
+  stock->end   = values->time[last];
+  stock->close = values->close[last];
 
-  if (!low || !json_object_is_type(low, json_type_double))
-  {
-    return 6;
-  }
+  stock->start = values->time[0];
+  stock->open  = values->open[0];
 
-  value->low = json_object_get_double(low);
+  stock->high = stock_column_max(values->high, values->count);
+  stock->low  = stock_column_min(values->low,  values->count);
 
   return 0;
 }
 
 /*
- * Parse stock values
+ * Calculate stock _start, _end, _open, _close, _high and _low values
  */
-static inline int stock_values_parse(stock_t* stock, struct json_object* result)
+static inline int stock_values_calc(stock_t* stock)
 {
-  struct json_object* indicators = json_object_object_get(result, "indicators");
+  const stock_values_t* values = &stock->_values;
 
-  if (!indicators)
+  if (values->count <= 0)
   {
-    error_print("Missing 'indicators' field: %s", stock->symbol);
-
     return 1;
   }
 
+  size_t last = values->count - 1;
 
-  struct json_object* quote = json_object_object_get(indicators, "quote");
+  stock->_end   = values->time[last];
+  stock->_close = values->close[last];
 
-  if (!quote || !json_object_is_type(quote, json_type_array))
-  {
-    error_print("Missing 'quote' field: %s", stock->symbol);
+  stock->_start = values->time[0];
+  stock->_open  = values->open[0];
 
-    return 2;
-  }
+  stock->_high = stock_column_max(values->high, values->count);
+  stock->_low  = stock_column_min(values->low,  values->count);
 
-  quote = json_object_array_get_idx(quote, 0);
+  return 0;
+}
 
+/*
+ * Free the nodes of pyramid
+ */
+static inline void stock_pyramid_free(stock_pyramid_t* pyramid)
+{
+  free(pyramid->highs);
 
-  struct json_object* time = json_object_object_get(result, "timestamp");
+  *pyramid = (stock_pyramid_t) { 0 };
+}
 
-  if (!time || !json_object_is_type(time, json_type_array))
+/*
+ * Get high and low of the node of pyramid at position of level
+ */
+static inline void stock_pyramid_node_get(double* high, double* low, const stock_pyramid_t* pyramid, const stock_values_t* values, size_t level, size_t position)
+{
+  if (level == 0)
   {
-    error_print("Missing 'timestamp' field: %s", stock->symbol);
-
-    return 3;
+    *high = values->high[position - pyramid->offset];
+    *low  = values->low[position - pyramid->offset];
+  }
+  else
+  {
+    *high = pyramid->highs[pyramid->starts[level] + position];
+    *low  = pyramid->lows[pyramid->starts[level] + position];
   }
+}
 
+/*
+ * Calculate the nodes of pyramid over the values from first to the last
+ * value, level after level
+ *
+ * A node at the edge of the values, with only one node below it that
+ * holds values, is a copy of that node
+ */
+static inline void stock_pyramid_extend(stock_pyramid_t* pyramid, const stock_values_t* values, size_t first)
+{
+  // Positions of the nodes below that hold values
+  size_t below_first = pyramid->offset;
+  size_t below_end   = pyramid->offset + pyramid->count;
 
-  struct json_object* volume = json_object_object_get(quote, "volume");
+  // Positions of the nodes below that changed
+  size_t start = pyramid->offset + first;
 
-  if (!volume || !json_object_is_type(volume, json_type_array))
+  for (size_t level = 1; level < pyramid->level_count; level++)
   {
-    error_print("Missing quote 'volume' field: %s", stock->symbol);
+    size_t end = (below_end + 1) / 2;
 
-    return 4;
-  }
+    for (size_t position = start / 2; position < end; position++)
+    {
+      size_t left = position * 2;
 
+      double high, low;
 
-  struct json_object* open = json_object_object_get(quote, "open");
+      if (left < below_first)
+      {
+        stock_pyramid_node_get(&high, &low, pyramid, values, level - 1, left + 1);
+      }
+      else
+      {
+        stock_pyramid_node_get(&high, &low, pyramid, values, level - 1, left);
 
-  if (!open || !json_object_is_type(open, json_type_array))
-  {
-    error_print("Missing quote 'open' field: %s", stock->symbol);
+        if (left + 1 < below_end)
+        {
+          double right_high, right_low;
 
-    return 5;
-  }
+          stock_pyramid_node_get(&right_high, &right_low, pyramid, values, level - 1, left + 1);
 
+          high = MAX(high, right_high);
+          low  = MIN(low,  right_low);
+        }
+      }
 
-  struct json_object* close = json_object_object_get(quote, "close");
+      pyramid->highs[pyramid->starts[level] + position] = high;
+      pyramid->lows[pyramid->starts[level] + position]  = low;
+    }
 
-  if (!close || !json_object_is_type(close, json_type_array))
-  {
-    error_print("Missing quote 'close' field: %s", stock->symbol);
+    below_first /= 2;
+    below_end    = end;
 
-    return 6;
+    start /= 2;
   }
+}
 
+/*
+ * Build pyramid of the highs and lows of values
+ *
+ * The pyramid has twice as many positions as values, for the values
+ * that are appended later
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | No values
+ * - 2 | Failed to allocate nodes
+ */
+static inline int stock_pyramid_build(stock_pyramid_t* pyramid, const stock_values_t* values)
+{
+  stock_pyramid_free(pyramid);
 
-  struct json_object* high = json_object_object_get(quote, "high");
-
-  if (!high || !json_object_is_type(high, json_type_array))
+  if (values->count == 0)
   {
-    error_print("Missing quote 'high' field: %s", stock->symbol);
-
-    return 7;
+    return 1;
   }
 
+  pyramid->capacity = values->count * 2;
 
-  struct json_object* low = json_object_object_get(quote, "low");
+  size_t level_capacity = pyramid->capacity;
 
-  if (!low || !json_object_is_type(low, json_type_array))
+  size_t level = 0;
+
+  while (level_capacity > 1)
   {
-    error_print("Missing quote 'low' field: %s", stock->symbol);
+    level++;
 
-    return 8;
+    pyramid->starts[level] = pyramid->node_count;
+
+    level_capacity = (level_capacity + 1) / 2;
+
+    pyramid->node_count += level_capacity;
   }
 
-  size_t count = json_object_array_length(open);
+  pyramid->level_count = level + 1;
 
-  stock->values = malloc(sizeof(stock_value_t) * count);
+  pyramid->highs = malloc(sizeof(double) * pyramid->node_count * 2);
 
-  if (!stock->values)
+  if (!pyramid->highs)
   {
-    error_print("Failed to malloc stock values");
+    *pyramid = (stock_pyramid_t) { 0 };
 
-    return 9;
+    return 2;
   }
 
-  stock->value_count = 0;
+  pyramid->lows = pyramid->highs + pyramid->node_count;
 
-  for (size_t index = 0; index < count; index++)
-  {
-    stock_value_t* value = &stock->values[stock->value_count];
+  pyramid->count = values->count;
 
-    if (stock_value_parse(value,
-      json_object_array_get_idx(time, index),
-      json_object_array_get_idx(volume, index),
-      json_object_array_get_idx(open, index),
-      json_object_array_get_idx(close, index),
-      json_object_array_get_idx(high, index),
-      json_object_array_get_idx(low, index)
-    ) == 0)
-    {
-      stock->value_count++;
-    }
-  }
+  stock_pyramid_extend(pyramid, values, 0);
 
   return 0;
 }
 
 /*
- * Get stock data from the internet
+ * Move pyramid along with values, after the values from keep_count were
+ * replaced and appended to, and the first drop_count values were dropped
+ *
+ * Only the nodes over the new values are calculated. If the positions
+ * run out, the pyramid is freed, and it is built again when it is used
  */
-static inline int stock_fetch(stock_t* stock)
+static inline void stock_pyramid_append(stock_pyramid_t* pyramid, const stock_values_t* values, size_t keep_count, size_t drop_count)
 {
-  char* response = stock_response_get(stock->symbol, stock->range, stock->interval);
-
-  if (!response)
+  if (!pyramid->highs)
   {
-    return 1;
+    return;
   }
 
-  struct json_object* json = json_tokener_parse(response);
-  
-  free(response);
+  size_t offset = pyramid->offset + drop_count;
 
-  if (!json)
+  if (keep_count <= drop_count || keep_count > pyramid->count ||
+      offset + values->count > pyramid->capacity)
   {
-    error_print("json_tokener_parse");
+    stock_pyramid_free(pyramid);
 
-    return 2;
+    return;
   }
 
-  struct json_object* chart = json_object_object_get(json, "chart");
+  pyramid->offset = offset;
 
-  if (!chart)
-  {
-    error_print("Missing 'chart' field: %s", stock->symbol);
+  pyramid->count = values->count;
 
-    json_object_put(json);
+  stock_pyramid_extend(pyramid, values, keep_count - drop_count);
+}
 
-    return 3;
-  }
+/*
+ * Get high and low of the values from first up to end, end excluded,
+ * by reading at most two nodes of every level of the pyramid
+ *
+ * Only the levels below the size of the range are read, so it reads
+ * O(log (end - first)) nodes
+ *
+ * The range has to have at least one value
+ */
+static inline void stock_pyramid_range_get(double* high, double* low, const stock_pyramid_t* pyramid, const stock_values_t* values, size_t first, size_t end)
+{
+  *high = values->high[first];
+  *low  = values->low[first];
 
-  struct json_object* result = json_object_object_get(chart, "result");
+  first += pyramid->offset;
+  end   += pyramid->offset;
 
-  if (!result || !json_object_is_type(result, json_type_array))
+  for (size_t level = 0; first < end; level++)
   {
-    error_print("Missing 'result' field: %s", stock->symbol);
+    double node_high, node_low;
 
-    json_object_put(json);
+    // A node that is not paired with its neighbour inside the range
+    // is read at this level, the others are read as their parent
+    if (first % 2 == 1)
+    {
+      stock_pyramid_node_get(&node_high, &node_low, pyramid, values, level, first);
 
-    return 4;
-  }
+      *high = MAX(*high, node_high);
+      *low  = MIN(*low,  node_low);
 
-  result = json_object_array_get_idx(result, 0);
+      first++;
+    }
 
-  if (stock_meta_parse(stock, result) != 0)
-  {
-    json_object_put(json);
+    if (end % 2 == 1)
+    {
+      end--;
 
-    return 5;
-  }
+      stock_pyramid_node_get(&node_high, &node_low, pyramid, values, level, end);
 
-  if (stock_values_parse(stock, result) != 0)
-  {
-    json_object_put(json);
+      *high = MAX(*high, node_high);
+      *low  = MIN(*low,  node_low);
+    }
 
-    return 6;
+    first /= 2;
+    end   /= 2;
   }
+}
 
-  json_object_put(json);
+/*
+ * Merge src_count values of src from src_first into count groups of
+ * values in dest
+ *
+ * Every group of values is merged into one value, with the open of the
+ * first value, the time, volume and close of the last value and the
+ * high and low of all values, which are read from the pyramid of src
+ *
+ * The first groups take one value each of the values that do not
+ * divide evenly into the groups
+ *
+ * Every group reads O(log (src_count / count)) nodes, so grouping reads
+ * O(count * log (src_count / count)) nodes instead of every value
+ */
+static inline void stock_values_group(stock_values_t* dest, const stock_values_t* src, const stock_pyramid_t* pyramid, size_t src_first, size_t src_count, size_t count)
+{
+  size_t group_size = src_count / count;
+
+  size_t spill = src_count - count * group_size;
+
+  size_t first = src_first;
+
+  for (size_t group_index = 0; group_index < count; group_index++)
+  {
+    size_t curr_size = (group_index < spill) ? group_size + 1 : group_size;
+
+    size_t last = first + curr_size - 1;
+
+    dest->time[group_index]   = src->time[last];
+    dest->volume[group_index] = src->volume[last];
+    dest->close[group_index]  = src->close[last];
+    dest->open[group_index]   = src->open[first];
+
+    stock_pyramid_range_get(&dest->high[group_index], &dest->low[group_index], pyramid, src, first, first + curr_size);
+
+    first += curr_size;
+  }
+}
+
+/*
+ * Build the pyramid of the values of stock, if it is not built
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | No values
+ * - 2 | Failed to allocate nodes
+ */
+static inline int stock_pyramid_update(stock_t* stock)
+{
+  if (stock->_pyramid.highs && stock->_pyramid.count == stock->values.count)
+  {
+    return 0;
+  }
+
+  return stock_pyramid_build(&stock->_pyramid, &stock->values);
+}
+
+/*
+ * Get end of the view of stock, clamped to the values
+ */
+static inline size_t stock_view_end_get(const stock_t* stock)
+{
+  size_t count = stock->values.count;
+
+  return (stock->_view_end > 0) ? MIN(stock->_view_end, count) : count;
+}
+
+/*
+ * Get first value of the view of stock, clamped to the end of the view
+ */
+static inline size_t stock_view_first_get(const stock_t* stock)
+{
+  return MIN(stock->_view_first, stock_view_end_get(stock));
+}
+
+/*
+ * Merge the values of stock from first up to end, end excluded, into
+ * one value, with the open of the first value, the time, volume and
+ * close of the last value and the high and low of all values
+ *
+ * The high and low are read from the pyramid, in O(log (end - first))
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Bad range
+ * - 2 | Failed to build pyramid
+ */
+int stock_range_get(stock_t* stock, stock_value_t* value, size_t first, size_t end)
+{
+  const stock_values_t* values = &stock->values;
+
+  if (first >= end || end > values->count)
+  {
+    return 1;
+  }
+
+  if (stock_pyramid_update(stock) != 0)
+  {
+    return 2;
+  }
+
+  *value = (stock_value_t)
+  {
+    .time   = values->time[end - 1],
+    .volume = values->volume[end - 1],
+    .close  = values->close[end - 1],
+    .open   = values->open[first],
+  };
+
+  stock_pyramid_range_get(&value->high, &value->low, &stock->_pyramid, values, first, end);
+
+  return 0;
+}
+
+static stock_resize_mode_t stock_resize_mode = STOCK_RESIZE_COUNT;
+
+/*
+ * Set how stock_resize groups the values of every stock
+ */
+void stock_resize_mode_set(stock_resize_mode_t mode)
+{
+  stock_resize_mode = mode;
+}
+
+/*
+ * Get how stock_resize groups the values of every stock
+ */
+stock_resize_mode_t stock_resize_mode_get(void)
+{
+  return stock_resize_mode;
+}
+
+/*
+ * Durations of time groups, in seconds
+ */
+const int64_t STOCK_RESIZE_STEPS[] =
+{
+  60, 2 * 60, 5 * 60, 10 * 60, 15 * 60, 30 * 60,
+  60 * 60, 2 * 60 * 60, 3 * 60 * 60, 4 * 60 * 60, 6 * 60 * 60, 12 * 60 * 60,
+  STOCK_DAY_SECONDS, 2 * STOCK_DAY_SECONDS, 7 * STOCK_DAY_SECONDS, 14 * STOCK_DAY_SECONDS,
+  30 * STOCK_DAY_SECONDS, 61 * STOCK_DAY_SECONDS, 91 * STOCK_DAY_SECONDS, 182 * STOCK_DAY_SECONDS,
+  365 * STOCK_DAY_SECONDS
+};
+
+#define STOCK_RESIZE_STEP_COUNT (sizeof(STOCK_RESIZE_STEPS) / sizeof(int64_t))
+
+/*
+ * Get the shortest duration of time groups that fits view_count values
+ * of the interval of stock into about count groups
+ *
+ * Only the durations in STOCK_RESIZE_STEPS are used, so the groups
+ * stay the same when count changes a little
+ */
+static inline int64_t stock_resize_step_get(const stock_t* stock, size_t view_count, size_t count)
+{
+  int64_t interval = stock_interval_seconds_get(stock_string_get(stock->interval));
+
+  if (interval <= 0)
+  {
+    interval = 60;
+  }
+
+  int64_t step = interval * ((view_count + count - 1) / count);
+
+  for (size_t index = 0; index < STOCK_RESIZE_STEP_COUNT; index++)
+  {
+    if (STOCK_RESIZE_STEPS[index] >= step)
+    {
+      return STOCK_RESIZE_STEPS[index];
+    }
+  }
+
+  int64_t year = STOCK_RESIZE_STEPS[STOCK_RESIZE_STEP_COUNT - 1];
+
+  return (step + year - 1) / year * year;
+}
+
+/*
+ * Get start of the time group of step seconds that time is in
+ */
+static inline int64_t stock_step_start_get(int64_t time, int64_t step)
+{
+  int64_t rest = time % step;
+
+  return (rest < 0) ? (time - rest - step) : (time - rest);
+}
+
+/*
+ * Get index of the first value at or after time, between first and end
+ */
+static inline size_t stock_time_index_search(const stock_values_t* values, size_t first, size_t end, int64_t time)
+{
+  while (first < end)
+  {
+    size_t middle = first + (end - first) / 2;
+
+    if (values->time[middle] < time)
+    {
+      first = middle + 1;
+    }
+    else
+    {
+      end = middle;
+    }
+  }
+
+  return first;
+}
+
+/*
+ * Merge the values of src from first up to end into the value at index
+ * of dest, like stock_range_get
+ */
+static inline void stock_value_merge(stock_values_t* dest, size_t index, const stock_values_t* src, const stock_pyramid_t* pyramid, size_t first, size_t end)
+{
+  dest->time[index]   = src->time[end - 1];
+  dest->volume[index] = src->volume[end - 1];
+  dest->close[index]  = src->close[end - 1];
+  dest->open[index]   = src->open[first];
+
+  stock_pyramid_range_get(&dest->high[index], &dest->low[index], pyramid, src, first, end);
+}
+
+/*
+ * Merge the values of the view of stock into groups of step seconds,
+ * aligned to the clock, and store the last count groups in _values
+ *
+ * Every group is found with a binary search of the times, and times
+ * without values are skipped
+ *
+ * If only values were appended since the last resize with the same
+ * step and count, the groups before the new values are kept, so only
+ * the last groups are merged again
+ */
+static inline void stock_resize_time(stock_t* stock, size_t first, size_t end, int64_t step, size_t count)
+{
+  const stock_values_t* values = &stock->values;
+
+  stock_values_t* resized = &stock->_values;
+
+  bool is_reusable =
+    resized->count       > 0     &&
+    stock->_resize_step  == step &&
+    stock->_resize_count == count &&
+    stock->_resize_first == first;
+
+  // Values before stable are the same as when the groups were merged
+  size_t stable = is_reusable ? MIN(stock->_resize_stable, end) : first;
+
+  bool is_end_stable = (stable == end && end == stock->_resize_end);
+
+  // Find the first value of the new groups, from the end backwards
+  size_t split = end;
+
+  size_t new_count = 0;
+
+  while (split > first && new_count < count)
+  {
+    // The group that ends at split is made of stable values only
+    if ((split < end && split <= stable) || (split == end && is_end_stable))
+    {
+      break;
+    }
+
+    int64_t start = stock_step_start_get(values->time[split - 1], step);
+
+    split = stock_time_index_search(values, first, split - 1, start);
+
+    new_count++;
+  }
+
+  // Keep the old groups of the values before split
+  size_t old_count = (split == end) ? resized->count :
+    stock_time_index_search(resized, 0, resized->count, values->time[split]);
+
+  size_t keep_count = (split > first) ? MIN(old_count, count - new_count) : 0;
+
+  if (keep_count < old_count)
+  {
+    stock_values_move(resized, 0, resized, old_count - keep_count, keep_count);
+  }
+
+  size_t index = keep_count;
+
+  while (split < end)
+  {
+    int64_t start = stock_step_start_get(values->time[split], step);
+
+    size_t next = stock_time_index_search(values, split, end, start + step);
+
+    stock_value_merge(resized, index++, values, &stock->_pyramid, split, next);
+
+    split = next;
+  }
+
+  resized->count = index;
+}
+
+#define STOCK_SMA_PERIOD       20
+#define STOCK_EMA_PERIOD       50
+#define STOCK_BOLLINGER_PERIOD 20
+#define STOCK_BOLLINGER_WIDTH  2.0
+#define STOCK_RSI_PERIOD       14
+#define STOCK_DONCHIAN_PERIOD  20
+
+/*
+ * Indicator of every line
+ */
+const stock_indicator_t STOCK_LINE_INDICATORS[STOCK_LINE_COUNT] =
+{
+  [STOCK_LINE_SMA]             = STOCK_INDICATOR_SMA,
+  [STOCK_LINE_EMA]             = STOCK_INDICATOR_EMA,
+  [STOCK_LINE_BOLLINGER_UPPER] = STOCK_INDICATOR_BOLLINGER,
+  [STOCK_LINE_BOLLINGER_LOWER] = STOCK_INDICATOR_BOLLINGER,
+  [STOCK_LINE_RSI]             = STOCK_INDICATOR_RSI,
+  [STOCK_LINE_VWAP]            = STOCK_INDICATOR_VWAP,
+  [STOCK_LINE_DONCHIAN_UPPER]  = STOCK_INDICATOR_DONCHIAN,
+  [STOCK_LINE_DONCHIAN_LOWER]  = STOCK_INDICATOR_DONCHIAN,
+};
+
+static int stock_indicator_mask = 0;
+
+/*
+ * Set which indicators are calculated, one bit per stock_indicator_t
+ */
+void stock_indicators_set(int mask)
+{
+  stock_indicator_mask = mask;
+}
+
+/*
+ * Get which indicators are calculated, one bit per stock_indicator_t
+ */
+int stock_indicators_get(void)
+{
+  return stock_indicator_mask;
+}
+
+/*
+ * Check if the indicator of line is in mask
+ */
+static inline bool stock_line_is_masked(stock_line_t line, int mask)
+{
+  return mask & (1 << STOCK_LINE_INDICATORS[line]);
+}
+
+#define STOCK_LINES_COLUMNS (STOCK_LINE_COUNT + 4)
+
+/*
+ * Make room for at least capacity values in the columns of lines,
+ * keeping the current values
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate memory
+ */
+static inline int stock_lines_reserve(stock_lines_t* lines, size_t capacity)
+{
+  if (capacity <= lines->capacity)
+  {
+    return 0;
+  }
+
+  double* block = malloc(sizeof(double) * STOCK_LINES_COLUMNS * capacity);
+
+  if (!block)
+  {
+    return 1;
+  }
+
+  double* columns[STOCK_LINES_COLUMNS];
+
+  for (size_t index = 0; index < STOCK_LINES_COLUMNS; index++)
+  {
+    columns[index] = block + capacity * index;
+  }
+
+  double** old_columns[STOCK_LINES_COLUMNS];
+
+  for (size_t index = 0; index < STOCK_LINE_COUNT; index++)
+  {
+    old_columns[index] = &lines->lines[index];
+  }
+
+  old_columns[STOCK_LINE_COUNT]     = &lines->gains;
+  old_columns[STOCK_LINE_COUNT + 1] = &lines->losses;
+  old_columns[STOCK_LINE_COUNT + 2] = &lines->prices;
+  old_columns[STOCK_LINE_COUNT + 3] = &lines->volumes;
+
+  double* old_block = lines->lines[0];
+
+  for (size_t index = 0; index < STOCK_LINES_COLUMNS; index++)
+  {
+    if (lines->count > 0)
+    {
+      memcpy(columns[index], *old_columns[index], sizeof(double) * lines->count);
+    }
+
+    *old_columns[index] = columns[index];
+  }
+
+  free(old_block);
+
+  lines->capacity = capacity;
+
+  return 0;
+}
+
+/*
+ * Free the columns of lines
+ */
+static inline void stock_lines_free(stock_lines_t* lines)
+{
+  free(lines->lines[0]);
+
+  *lines = (stock_lines_t) { 0 };
+}
+
+/*
+ * Drop the first count values of the columns of lines
+ */
+static inline void stock_lines_drop(stock_lines_t* lines, size_t count)
+{
+  count = MIN(count, lines->count);
+
+  if (count == 0)
+  {
+    return;
+  }
+
+  size_t rest = lines->count - count;
+
+  for (size_t index = 0; index < STOCK_LINE_COUNT; index++)
+  {
+    memmove(lines->lines[index], lines->lines[index] + count, sizeof(double) * rest);
+  }
+
+  memmove(lines->gains,   lines->gains   + count, sizeof(double) * rest);
+  memmove(lines->losses,  lines->losses  + count, sizeof(double) * rest);
+  memmove(lines->prices,  lines->prices  + count, sizeof(double) * rest);
+  memmove(lines->volumes, lines->volumes + count, sizeof(double) * rest);
+
+  lines->count = rest;
+}
+
+/*
+ * Calculate simple moving average and bollinger bands from first up
+ * to end, with a running sum of the closes and of their squares
+ *
+ * The running sums start from the values before first, so continuing
+ * from first only reads one period of values
+ */
+static inline void stock_average_calc(stock_lines_t* lines, const stock_values_t* values, size_t first, size_t end, size_t period, stock_line_t line, bool is_bollinger)
+{
+  const double* closes = values->close;
+
+  double sum     = 0;
+  double squares = 0;
+
+  for (size_t index = (first > period) ? first - period : 0; index < first; index++)
+  {
+    sum     += closes[index];
+    squares += closes[index] * closes[index];
+  }
+
+  for (size_t index = first; index < end; index++)
+  {
+    if (index >= period)
+    {
+      sum     -= closes[index - period];
+      squares -= closes[index - period] * closes[index - period];
+    }
+
+    sum     += closes[index];
+    squares += closes[index] * closes[index];
+
+    if (index + 1 < period && !is_bollinger)
+    {
+      lines->lines[line][index] = NAN;
+
+      continue;
+    }
+
+    if (index + 1 < period)
+    {
+      lines->lines[STOCK_LINE_BOLLINGER_UPPER][index] = NAN;
+      lines->lines[STOCK_LINE_BOLLINGER_LOWER][index] = NAN;
+
+      continue;
+    }
+
+    double mean = sum / period;
+
+    if (!is_bollinger)
+    {
+      lines->lines[line][index] = mean;
+
+      continue;
+    }
+
+    double width = STOCK_BOLLINGER_WIDTH * sqrt(MAX(squares / period - mean * mean, 0));
+
+    lines->lines[STOCK_LINE_BOLLINGER_UPPER][index] = mean + width;
+    lines->lines[STOCK_LINE_BOLLINGER_LOWER][index] = mean - width;
+  }
+}
+
+/*
+ * Calculate exponential moving average from first up to end,
+ * continuing from the average of the value before first
+ */
+static inline void stock_ema_calc(stock_lines_t* lines, const stock_values_t* values, size_t first, size_t end)
+{
+  double* line = lines->lines[STOCK_LINE_EMA];
+
+  double alpha = 2.0 / (STOCK_EMA_PERIOD + 1);
+
+  double average = (first > 0) ? line[first - 1] : values->close[0];
+
+  for (size_t index = first; index < end; index++)
+  {
+    average += alpha * (values->close[index] - average);
+
+    line[index] = average;
+  }
+}
+
+/*
+ * Calculate relative strength index with the averages of Wilder from
+ * first up to end, continuing from the averages of the value before
+ *
+ * Before the first period, the gains and losses columns hold sums
+ */
+static inline void stock_rsi_calc(stock_lines_t* lines, const stock_values_t* values, size_t first, size_t end)
+{
+  const size_t period = STOCK_RSI_PERIOD;
+
+  for (size_t index = first; index < end; index++)
+  {
+    double change = (index > 0) ? values->close[index] - values->close[index - 1] : 0;
+
+    double gain = MAX(change, 0);
+    double loss = MAX(-change, 0);
+
+    double last_gain = (index > 0) ? lines->gains[index - 1]  : 0;
+    double last_loss = (index > 0) ? lines->losses[index - 1] : 0;
+
+    if (index < period)
+    {
+      lines->gains[index]  = last_gain + gain;
+      lines->losses[index] = last_loss + loss;
+
+      lines->lines[STOCK_LINE_RSI][index] = NAN;
+
+      continue;
+    }
+
+    if (index == period)
+    {
+      lines->gains[index]  = (last_gain + gain) / period;
+      lines->losses[index] = (last_loss + loss) / period;
+    }
+    else
+    {
+      lines->gains[index]  = (last_gain * (period - 1) + gain) / period;
+      lines->losses[index] = (last_loss * (period - 1) + loss) / period;
+    }
+
+    double average_gain = lines->gains[index];
+    double average_loss = lines->losses[index];
+
+    lines->lines[STOCK_LINE_RSI][index] = (average_loss > 0) ?
+      100 - 100 / (1 + average_gain / average_loss) :
+      (average_gain > 0) ? 100 : 50;
+  }
+}
+
+/*
+ * Calculate volume weighted average price from first up to end,
+ * continuing from the sums of the value before first
+ *
+ * Intraday values start over every day
+ */
+static inline void stock_vwap_calc(stock_lines_t* lines, const stock_values_t* values, size_t first, size_t end, bool is_intraday)
+{
+  for (size_t index = first; index < end; index++)
+  {
+    double price = (values->high[index] + values->low[index] + values->close[index]) / 3;
+
+    double volume = values->volume[index];
+
+    bool is_first = (index == 0) || (is_intraday &&
+      values->time[index] / STOCK_DAY_SECONDS != values->time[index - 1] / STOCK_DAY_SECONDS);
+
+    lines->prices[index]  = (is_first ? 0 : lines->prices[index - 1])  + price * volume;
+    lines->volumes[index] = (is_first ? 0 : lines->volumes[index - 1]) + volume;
+
+    lines->lines[STOCK_LINE_VWAP][index] = (lines->volumes[index] > 0) ?
+      lines->prices[index] / lines->volumes[index] : price;
+  }
+}
+
+/*
+ * Monotonic deque of value indexes, for the max or min of a window
+ */
+typedef struct stock_deque_t
+{
+  size_t items[STOCK_DONCHIAN_PERIOD];
+  size_t first;
+  size_t count;
+} stock_deque_t;
+
+/*
+ * Push index to the back of deque, after dropping the indexes that
+ * fell out of the window and the indexes that can not be the max,
+ * or min, of the window anymore
+ */
+static inline void stock_deque_push(stock_deque_t* deque, const double* column, size_t index, bool is_max)
+{
+  const size_t size = STOCK_DONCHIAN_PERIOD;
+
+  while (deque->count > 0 && deque->items[deque->first] + size <= index)
+  {
+    deque->first = (deque->first + 1) % size;
+
+    deque->count--;
+  }
+
+  while (deque->count > 0)
+  {
+    double last = column[deque->items[(deque->first + deque->count - 1) % size]];
+
+    if (is_max ? (last > column[index]) : (last < column[index])) break;
+
+    deque->count--;
+  }
+
+  deque->items[(deque->first + deque->count) % size] = index;
+
+  deque->count++;
+}
+
+/*
+ * Calculate donchian channel from first up to end, with monotonic
+ * deques of the highs and lows of the window
+ *
+ * The deques start from the values before first, so continuing from
+ * first only reads one period of values
+ */
+static inline void stock_donchian_calc(stock_lines_t* lines, const stock_values_t* values, size_t first, size_t end)
+{
+  const size_t period = STOCK_DONCHIAN_PERIOD;
+
+  stock_deque_t highs = { 0 };
+  stock_deque_t lows  = { 0 };
+
+  for (size_t index = (first > period) ? first - period : 0; index < end; index++)
+  {
+    stock_deque_push(&highs, values->high, index, true);
+    stock_deque_push(&lows,  values->low,  index, false);
+
+    if (index < first) continue;
+
+    bool is_full = (index + 1 >= period);
+
+    lines->lines[STOCK_LINE_DONCHIAN_UPPER][index] = is_full ? values->high[highs.items[highs.first]] : NAN;
+    lines->lines[STOCK_LINE_DONCHIAN_LOWER][index] = is_full ? values->low[lows.items[lows.first]]    : NAN;
+  }
+}
+
+/*
+ * Calculate the indicators of the values of stock that do not have
+ * them yet
+ *
+ * Every indicator continues from the values it already has, so after
+ * the first calculation, new values only cost one period each
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate memory
+ */
+static inline int stock_indicators_update(stock_t* stock)
+{
+  stock_lines_t* lines = &stock->_indicators;
+
+  const stock_values_t* values = &stock->values;
+
+  int mask = stock_indicator_mask;
+
+  // Indicators that were not calculated need every value
+  if (mask & ~lines->mask)
+  {
+    lines->count = 0;
+  }
+
+  lines->mask = mask;
+
+  size_t first = MIN(lines->count, values->count);
+
+  size_t end = values->count;
+
+  if (mask == 0 || first == end)
+  {
+    return 0;
+  }
+
+  // The capacity doubles, so appending one value is O(1) on average
+  if (end > lines->capacity && stock_lines_reserve(lines, MAX(end, lines->capacity * 2)) != 0)
+  {
+    return 1;
+  }
+
+  if (mask & (1 << STOCK_INDICATOR_SMA))
+  {
+    stock_average_calc(lines, values, first, end, STOCK_SMA_PERIOD, STOCK_LINE_SMA, false);
+  }
+
+  if (mask & (1 << STOCK_INDICATOR_EMA))
+  {
+    stock_ema_calc(lines, values, first, end);
+  }
+
+  if (mask & (1 << STOCK_INDICATOR_BOLLINGER))
+  {
+    stock_average_calc(lines, values, first, end, STOCK_BOLLINGER_PERIOD, STOCK_LINE_BOLLINGER_UPPER, true);
+  }
+
+  if (mask & (1 << STOCK_INDICATOR_RSI))
+  {
+    stock_rsi_calc(lines, values, first, end);
+  }
+
+  if (mask & (1 << STOCK_INDICATOR_VWAP))
+  {
+    bool is_intraday = stock_interval_seconds_get(stock_string_get(stock->interval)) < STOCK_DAY_SECONDS;
+
+    stock_vwap_calc(lines, values, first, end, is_intraday);
+  }
+
+  if (mask & (1 << STOCK_INDICATOR_DONCHIAN))
+  {
+    stock_donchian_calc(lines, values, first, end);
+  }
+
+  lines->count = end;
+
+  return 0;
+}
+
+/*
+ * Resize the indicator lines of the values of stock to _lines, taking
+ * the lines of the last value of every value of _values
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to calculate indicators
+ * - 2 | Failed to allocate memory
+ */
+static inline int stock_lines_resize(stock_t* stock, size_t first, size_t end)
+{
+  const stock_values_t* values = &stock->values;
+
+  const stock_values_t* resized = &stock->_values;
+
+  if (stock_indicators_update(stock) != 0)
+  {
+    return 1;
+  }
+
+  stock_lines_t* lines = &stock->_lines;
+
+  lines->count = 0;
+
+  if (stock_lines_reserve(lines, resized->capacity) != 0)
+  {
+    return 2;
+  }
+
+  int mask = stock->_indicators.mask;
+
+  size_t index = first;
+
+  for (size_t resized_index = 0; resized_index < resized->count; resized_index++)
+  {
+    index = stock_time_index_search(values, index, end, resized->time[resized_index]);
+
+    for (stock_line_t line = 0; line < STOCK_LINE_COUNT; line++)
+    {
+      if (!stock_line_is_masked(line, mask)) continue;
+
+      lines->lines[line][resized_index] = stock->_indicators.lines[line][index];
+    }
+  }
+
+  lines->count = resized->count;
+
+  lines->mask = mask;
+
+  return 0;
+}
+
+/*
+ * Resize the values of the view of stock and store them in _values
+ *
+ * The high and low of every group is read from the pyramid of the
+ * values, so resizing n values to count groups reads
+ * O(count * log (n / count)) nodes instead of all n values. It grows
+ * with the number of values, but only by the logarithm of the group size
+ *
+ * If count is more than the values of the view, every value is kept
+ *
+ * The _values buffer is only reallocated when count grows, and nothing
+ * is done if neither the version, the view nor count has changed
+ *
+ * In TIME mode, the values are merged into at most count groups of a
+ * duration that is aligned to the clock, see stock_resize_time
+ *
+ * Only the charts resize stocks, when they render, so the indicators
+ * of stocks that are not charted are never calculated
+ */
+int stock_resize(stock_t* stock, size_t count)
+{
+  const stock_values_t* values = &stock->values;
+
+  size_t first = stock_view_first_get(stock);
+
+  size_t view_count = stock_view_end_get(stock) - first;
+
+  count = MIN(count, view_count);
+
+  if (count == 0)
+  {
+    return 1;
+  }
+
+  size_t end = first + view_count;
+
+  int64_t step = (stock_resize_mode == STOCK_RESIZE_TIME) ?
+    stock_resize_step_get(stock, view_count, count) : 0;
+
+  // Nothing has changed since the last resize
+  if (stock->_resize_count   == count          &&
+      stock->_resize_step    == step           &&
+      stock->_resize_mask    == stock_indicator_mask &&
+      stock->_resize_version == stock->version &&
+      stock->_resize_first   == first          &&
+      stock->_resize_end     == end)
+  {
+    return 0;
+  }
+
+  // The pyramid is built once for every new set of values
+  if ((step > 0 || count < view_count) && stock_pyramid_update(stock) != 0)
+  {
+    return 3;
+  }
+
+  stock_values_t* resized = &stock->_values;
+
+  // The old values are overwritten, so they are not copied if it grows
+  if (resized->capacity < count)
+  {
+    resized->count = 0;
+
+    if (stock_values_reserve(resized, count) != 0)
+    {
+      return 2;
+    }
+  }
+
+  if (step > 0)
+  {
+    stock_resize_time(stock, first, end, step, count);
+  }
+  // Groups of one value are just copies
+  else if (count == view_count)
+  {
+    stock_values_move(resized, 0, values, first, count);
+
+    resized->count = count;
+  }
+  else
+  {
+    stock_values_group(resized, values, &stock->_pyramid, first, view_count, count);
+
+    resized->count = count;
+  }
+
+  stock->_resize_version = stock->version;
+  stock->_resize_first   = first;
+  stock->_resize_end     = end;
+  stock->_resize_count   = count;
+  stock->_resize_step    = step;
+  stock->_resize_stable  = values->count;
+  stock->_resize_mask    = stock_indicator_mask;
+
+  if (stock_indicator_mask != 0 && stock_lines_resize(stock, first, end) != 0)
+  {
+    stock->_resize_mask = 0;
+
+    stock->_lines.count = 0;
+  }
+
+  if (stock_values_calc(stock) != 0)
+  {
+    // Maybe use copy stock and then return error here
+  }
+
+  return 0;
+}
+
+/*
+ * Set the view of stock to the values from first up to end, end excluded
+ *
+ * stock_resize only resizes the values of the view, so the chart shows
+ * them and is scaled to their high and low, without fetching anything
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Bad range
+ */
+int stock_view_set(stock_t* stock, size_t first, size_t end)
+{
+  if (first >= end || end > stock->values.count)
+  {
+    return 1;
+  }
+
+  stock->_view_first = first;
+  stock->_view_end   = end;
+
+  return 0;
+}
+
+/*
+ * Get index of the first value at or after time
+ *
+ * RETURN (size_t index)
+ * - count | Every value is before time
+ */
+static inline size_t stock_time_index_get(const stock_values_t* values, int64_t time)
+{
+  size_t low  = 0;
+  size_t high = values->count;
+
+  while (low < high)
+  {
+    size_t middle = low + (high - low) / 2;
+
+    if (values->time[middle] < time)
+    {
+      low = middle + 1;
+    }
+    else
+    {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+/*
+ * Set the view of stock to the values from start time up to end time,
+ * end time excluded
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | No values between the times
+ */
+int stock_view_time_set(stock_t* stock, int64_t start, int64_t end)
+{
+  size_t first = stock_time_index_get(&stock->values, start);
+
+  size_t last  = stock_time_index_get(&stock->values, end);
+
+  return stock_view_set(stock, first, last);
+}
+
+/*
+ * Reset the view of stock to all values
+ */
+void stock_view_reset(stock_t* stock)
+{
+  stock->_view_first = 0;
+  stock->_view_end   = 0;
+}
+
+#define STOCK_VIEW_MIN 8
+
+/*
+ * Zoom the view of stock by factor, keeping the end of the view
+ *
+ * A factor below 1 zooms in and a factor above 1 zooms out, and a view
+ * of every value is reset to follow new values
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Bad factor or no values
+ * - 2 | The view can not be zoomed further
+ */
+int stock_view_zoom(stock_t* stock, double factor)
+{
+  size_t value_count = stock->values.count;
+
+  if (factor <= 0 || value_count == 0)
+  {
+    return 1;
+  }
+
+  size_t end   = stock_view_end_get(stock);
+  size_t first = stock_view_first_get(stock);
+
+  size_t count = end - first;
+
+  size_t new_count = MAX(factor * count, MIN(STOCK_VIEW_MIN, value_count));
+
+  if (new_count >= value_count)
+  {
+    if (count == value_count)
+    {
+      return 2;
+    }
+
+    stock_view_reset(stock);
+
+    return 0;
+  }
+
+  if (new_count == count)
+  {
+    return 2;
+  }
+
+  // Move the end forward if there is not enough values before it
+  size_t new_end = MAX(end, new_count);
+
+  stock->_view_first = new_end - new_count;
+  stock->_view_end   = new_end;
+
+  return 0;
+}
+
+/*
+ * Pan the view of stock by fraction of its length, at least one value
+ *
+ * A negative fraction pans back in time and a positive forward
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | No values
+ * - 2 | The view is at the first or last value
+ */
+int stock_view_pan(stock_t* stock, double fraction)
+{
+  size_t value_count = stock->values.count;
+
+  if (value_count == 0)
+  {
+    return 1;
+  }
+
+  size_t end   = stock_view_end_get(stock);
+  size_t first = stock_view_first_get(stock);
+
+  size_t count = end - first;
+
+  ssize_t offset = fraction * count;
+
+  if (offset == 0)
+  {
+    offset = (fraction < 0) ? -1 : 1;
+  }
+
+  ssize_t new_first = first + offset;
+
+  new_first = MAX(new_first, 0);
+  new_first = MIN(new_first, (ssize_t) (value_count - count));
+
+  if (new_first == first)
+  {
+    return 2;
+  }
+
+  stock->_view_first = new_first;
+  stock->_view_end   = new_first + count;
+
+  return 0;
+}
+
+/*
+ * Keys of the chart response that the parser cares about
+ */
+typedef enum stock_key_t
+{
+  STOCK_KEY_NONE,
+  STOCK_KEY_CHART,
+  STOCK_KEY_RESULT,
+  STOCK_KEY_META,
+  STOCK_KEY_TIMESTAMP,
+  STOCK_KEY_INDICATORS,
+  STOCK_KEY_QUOTE,
+  STOCK_KEY_VOLUME,
+  STOCK_KEY_OPEN,
+  STOCK_KEY_CLOSE,
+  STOCK_KEY_HIGH,
+  STOCK_KEY_LOW,
+  STOCK_KEY_CURRENCY,
+  STOCK_KEY_LONG_NAME,
+  STOCK_KEY_SHORT_NAME,
+  STOCK_KEY_EXCHANGE,
+  STOCK_KEY_MARKET_VOLUME,
+  STOCK_KEY_MARKET_PRICE,
+  STOCK_KEY_MARKET_HIGH,
+  STOCK_KEY_MARKET_LOW,
+  STOCK_KEY_PERIOD,
+  STOCK_KEY_REGULAR,
+  STOCK_KEY_START,
+  STOCK_KEY_END,
+} stock_key_t;
+
+const char* STOCK_KEYS[] =
+{
+  [STOCK_KEY_NONE]          = "",
+  [STOCK_KEY_CHART]         = "chart",
+  [STOCK_KEY_RESULT]        = "result",
+  [STOCK_KEY_META]          = "meta",
+  [STOCK_KEY_TIMESTAMP]     = "timestamp",
+  [STOCK_KEY_INDICATORS]    = "indicators",
+  [STOCK_KEY_QUOTE]         = "quote",
+  [STOCK_KEY_VOLUME]        = "volume",
+  [STOCK_KEY_OPEN]          = "open",
+  [STOCK_KEY_CLOSE]         = "close",
+  [STOCK_KEY_HIGH]          = "high",
+  [STOCK_KEY_LOW]           = "low",
+  [STOCK_KEY_CURRENCY]      = "currency",
+  [STOCK_KEY_LONG_NAME]     = "longName",
+  [STOCK_KEY_SHORT_NAME]    = "shortName",
+  [STOCK_KEY_EXCHANGE]      = "fullExchangeName",
+  [STOCK_KEY_MARKET_VOLUME] = "regularMarketVolume",
+  [STOCK_KEY_MARKET_PRICE]  = "regularMarketPrice",
+  [STOCK_KEY_MARKET_HIGH]   = "regularMarketDayHigh",
+  [STOCK_KEY_MARKET_LOW]    = "regularMarketDayLow",
+  [STOCK_KEY_PERIOD]        = "currentTradingPeriod",
+  [STOCK_KEY_REGULAR]       = "regular",
+  [STOCK_KEY_START]         = "start",
+  [STOCK_KEY_END]           = "end",
+};
+
+#define STOCK_KEY_COUNT (sizeof(STOCK_KEYS) / sizeof(char*))
+
+/*
+ * Get key of string, or STOCK_KEY_NONE if the key is not of interest
+ */
+static inline stock_key_t stock_key_get(const char* string)
+{
+  for (size_t key = 1; key < STOCK_KEY_COUNT; key++)
+  {
+    if (strcmp(STOCK_KEYS[key], string) == 0)
+    {
+      return key;
+    }
+  }
+
+  return STOCK_KEY_NONE;
+}
+
+/*
+ * Nodes of the chart response, everything else is skipped
+ */
+typedef enum stock_node_t
+{
+  STOCK_NODE_SKIP,
+  STOCK_NODE_ROOT,
+  STOCK_NODE_CHART,
+  STOCK_NODE_RESULTS,
+  STOCK_NODE_RESULT,
+  STOCK_NODE_META,
+  STOCK_NODE_PERIODS,
+  STOCK_NODE_PERIOD,
+  STOCK_NODE_INDICATORS,
+  STOCK_NODE_QUOTES,
+  STOCK_NODE_QUOTE,
+  STOCK_NODE_COLUMN,
+} stock_node_t;
+
+/*
+ * Bits of stock value fields, one for each column in the response
+ */
+#define STOCK_FIELD_TIME   (1 << 0)
+#define STOCK_FIELD_VOLUME (1 << 1)
+#define STOCK_FIELD_OPEN   (1 << 2)
+#define STOCK_FIELD_CLOSE  (1 << 3)
+#define STOCK_FIELD_HIGH   (1 << 4)
+#define STOCK_FIELD_LOW    (1 << 5)
+#define STOCK_FIELD_ALL    ((1 << 6) - 1)
+
+/*
+ * Get field bit of column key
+ */
+static inline int stock_key_field_get(stock_key_t key)
+{
+  switch (key)
+  {
+    case STOCK_KEY_TIMESTAMP: return STOCK_FIELD_TIME;
+    case STOCK_KEY_VOLUME:    return STOCK_FIELD_VOLUME;
+    case STOCK_KEY_OPEN:      return STOCK_FIELD_OPEN;
+    case STOCK_KEY_CLOSE:     return STOCK_FIELD_CLOSE;
+    case STOCK_KEY_HIGH:      return STOCK_FIELD_HIGH;
+    case STOCK_KEY_LOW:       return STOCK_FIELD_LOW;
+    default:                  return 0;
+  }
+}
+
+/*
+ * One level of nested objects and arrays
+ *
+ * key    - key of the current value, in objects
+ * index  - index of the current value, in arrays
+ * is_key - the next string in the object is a key
+ */
+typedef struct stock_level_t
+{
+  stock_node_t node;
+  stock_key_t  key;
+  size_t       index;
+  bool         is_object;
+  bool         is_key;
+} stock_level_t;
+
+/*
+ * States of the parser lexer
+ */
+typedef enum stock_lex_t
+{
+  STOCK_LEX_VALUE,
+  STOCK_LEX_STRING,
+  STOCK_LEX_ESCAPE,
+  STOCK_LEX_UNICODE,
+  STOCK_LEX_NUMBER,
+  STOCK_LEX_LITERAL,
+} stock_lex_t;
+
+#define STOCK_PARSER_DEPTH 32
+
+#define STOCK_META_COUNT 4
+
+/*
+ * Buffers of the meta strings of parser, one for every meta key
+ */
+typedef struct stock_metas_t
+{
+  char*  strings[STOCK_META_COUNT];
+  size_t capacities[STOCK_META_COUNT];
+} stock_metas_t;
+
+/*
+ * Streaming parser specialized for the yahoo chart response
+ *
+ * Only chart.result[0] is parsed, the timestamp and quote columns are
+ * written straight into the values array, everything else is skipped
+ *
+ * The values are masked by the columns that had a number at that index,
+ * candles with a missing (null) field are dropped when taken
+ */
+typedef struct stock_parser_t
+{
+  stock_lex_t    state;
+  char*          token;
+  size_t         token_size;
+  size_t         token_capacity;
+  uint32_t       unicode;
+  int            unicode_size;
+  uint32_t       surrogate;
+
+  stock_level_t  levels[STOCK_PARSER_DEPTH];
+  size_t         depth;
+
+  stock_values_t values;
+  uint8_t*       masks;
+  int            fields;
+
+  stock_metas_t  metas;  // Buffers of the meta strings, kept for every response
+  char*          currency;
+  char*          long_name;
+  char*          short_name;
+  char*          exchange;
+  int            volume;
+  stock_market_t market;
+  bool           has_volume;
+  bool           has_result;
+  bool           has_meta;
+  bool           is_done;
+} stock_parser_t;
+
+/*
+ * Append character to token of parser
+ */
+static inline int stock_parser_token_append(stock_parser_t* parser, char symbol)
+{
+  if (parser->token_size + 1 >= parser->token_capacity)
+  {
+    size_t capacity = MAX(parser->token_capacity * 2, 64);
+
+    char* token = realloc(parser->token, sizeof(char) * capacity);
+
+    if (!token)
+    {
+      return 1;
+    }
+
+    parser->token          = token;
+    parser->token_capacity = capacity;
+  }
+
+  parser->token[parser->token_size++] = symbol;
+
+  return 0;
+}
+
+/*
+ * Append unicode code point to token of parser, encoded as utf-8
+ */
+static inline int stock_parser_unicode_append(stock_parser_t* parser, uint32_t code)
+{
+  if (code < 0x80)
+  {
+    return stock_parser_token_append(parser, code);
+  }
+
+  if (code < 0x800)
+  {
+    return stock_parser_token_append(parser, 0xC0 | (code >> 6)) ||
+           stock_parser_token_append(parser, 0x80 | (code & 0x3F));
+  }
+
+  if (code < 0x10000)
+  {
+    return stock_parser_token_append(parser, 0xE0 | (code >> 12)) ||
+           stock_parser_token_append(parser, 0x80 | ((code >> 6) & 0x3F)) ||
+           stock_parser_token_append(parser, 0x80 | (code & 0x3F));
+  }
+
+  return stock_parser_token_append(parser, 0xF0 | (code >> 18)) ||
+         stock_parser_token_append(parser, 0x80 | ((code >> 12) & 0x3F)) ||
+         stock_parser_token_append(parser, 0x80 | ((code >> 6) & 0x3F)) ||
+         stock_parser_token_append(parser, 0x80 | (code & 0x3F));
+}
+
+/*
+ * Make room for at least capacity values in parser
+ */
+static inline int stock_parser_reserve(stock_parser_t* parser, size_t capacity)
+{
+  size_t old_capacity = parser->values.capacity;
+
+  if (capacity <= old_capacity)
+  {
+    return 0;
+  }
+
+  size_t new_capacity = MAX(old_capacity * 2, 256);
+
+  while (new_capacity < capacity)
+  {
+    new_capacity *= 2;
+  }
+
+  uint8_t* masks = realloc(parser->masks, sizeof(uint8_t) * new_capacity);
+
+  if (!masks)
+  {
+    return 1;
+  }
+
+  memset(masks + old_capacity, 0, sizeof(uint8_t) * (new_capacity - old_capacity));
+
+  parser->masks = masks;
+
+  if (stock_values_reserve(&parser->values, new_capacity) != 0)
+  {
+    return 2;
+  }
+
+  return 0;
+}
+
+const double STOCK_POWERS[] =
+{
+  1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+/*
+ * Convert number string to double
+ *
+ * Plain decimals with at most 15 significant digits are exact with one
+ * division, the rest falls back to strtod
+ */
+static inline double stock_double_get(const char* string)
+{
+  const char* pointer = string;
+
+  bool is_negative = (*pointer == '-');
+
+  if (is_negative) pointer++;
+
+  uint64_t mantissa = 0;
+
+  int digits = 0;
+
+  int decimals = 0;
+
+  for (; *pointer >= '0' && *pointer <= '9'; pointer++, digits++)
+  {
+    mantissa = mantissa * 10 + (*pointer - '0');
+  }
+
+  if (*pointer == '.')
+  {
+    for (pointer++; *pointer >= '0' && *pointer <= '9'; pointer++, digits++, decimals++)
+    {
+      mantissa = mantissa * 10 + (*pointer - '0');
+    }
+  }
+
+  if (*pointer != '\0' || digits > 15 || decimals > 22)
+  {
+    return strtod(string, NULL);
+  }
+
+  double value = (double) mantissa / STOCK_POWERS[decimals];
+
+  return is_negative ? -value : value;
+}
+
+/*
+ * Convert number string to integer, truncating decimals
+ */
+static inline int64_t stock_int_get(const char* string)
+{
+  const char* pointer = string;
+
+  bool is_negative = (*pointer == '-');
+
+  if (is_negative) pointer++;
+
+  int64_t value = 0;
+
+  for (; *pointer >= '0' && *pointer <= '9'; pointer++)
+  {
+    value = value * 10 + (*pointer - '0');
+  }
+
+  if (*pointer != '\0' && *pointer != '.')
+  {
+    return (int64_t) strtod(string, NULL);
+  }
+
+  return is_negative ? -value : value;
+}
+
+/*
+ * Store number at index of column in the values array
+ */
+static inline int stock_parser_column_set(stock_parser_t* parser, stock_key_t key, size_t index, const char* number)
+{
+  if (stock_parser_reserve(parser, index + 1) != 0)
+  {
+    return 1;
+  }
+
+  stock_values_t* values = &parser->values;
+
+  values->count = MAX(values->count, index + 1);
+
+  // A null value leaves the field unmasked
+  if (!number)
+  {
+    return 0;
+  }
+
+  switch (key)
+  {
+    case STOCK_KEY_TIMESTAMP:
+      values->time[index] = stock_int_get(number);
+      break;
+
+    case STOCK_KEY_VOLUME:
+      values->volume[index] = stock_int_get(number);
+      break;
+
+    case STOCK_KEY_OPEN:
+      values->open[index] = stock_double_get(number);
+      break;
+
+    case STOCK_KEY_CLOSE:
+      values->close[index] = stock_double_get(number);
+      break;
+
+    case STOCK_KEY_HIGH:
+      values->high[index] = stock_double_get(number);
+      break;
+
+    case STOCK_KEY_LOW:
+      values->low[index] = stock_double_get(number);
+      break;
+
+    default:
+      return 0;
+  }
+
+  parser->masks[index] |= stock_key_field_get(key);
+
+  return 0;
+}
+
+/*
+ * Store meta string of key, replacing any earlier string
+ *
+ * The string is copied into the buffer of key, which only grows
+ */
+static inline int stock_parser_meta_set(stock_parser_t* parser, stock_key_t key, const char* string)
+{
+  char** field = NULL;
+
+  size_t index = 0;
+
+  switch (key)
+  {
+    case STOCK_KEY_CURRENCY:
+      field = &parser->currency;
+      index = 0;
+      break;
+
+    case STOCK_KEY_LONG_NAME:
+      field = &parser->long_name;
+      index = 1;
+      break;
+
+    case STOCK_KEY_SHORT_NAME:
+      field = &parser->short_name;
+      index = 2;
+      break;
+
+    case STOCK_KEY_EXCHANGE:
+      field = &parser->exchange;
+      index = 3;
+      break;
+
+    default:
+      return 0;
+  }
+
+  stock_metas_t* metas = &parser->metas;
+
+  size_t size = strlen(string) + 1;
+
+  if (size > metas->capacities[index])
+  {
+    size_t capacity = MAX(size, 64);
+
+    char* buffer = realloc(metas->strings[index], capacity);
+
+    if (!buffer)
+    {
+      return 1;
+    }
+
+    metas->strings[index]    = buffer;
+    metas->capacities[index] = capacity;
+  }
+
+  *field = memcpy(metas->strings[index], string, size);
+
+  return 0;
+}
+
+/*
+ * Token types of scalar values
+ */
+#define STOCK_TOKEN_STRING 0
+#define STOCK_TOKEN_NUMBER 1
+#define STOCK_TOKEN_TRUE   2
+#define STOCK_TOKEN_FALSE  3
+#define STOCK_TOKEN_NULL   4
+
+/*
+ * Handle scalar value, the token is in the parser
+ */
+static inline int stock_parser_scalar(stock_parser_t* parser, int type)
+{
+  if (parser->depth == 0)
+  {
+    return 1;
+  }
+
+  stock_level_t* level = &parser->levels[parser->depth - 1];
+
+  if (level->is_object && level->is_key)
+  {
+    return 2;
+  }
+
+  const char* token = parser->token;
+
+  switch (level->node)
+  {
+    case STOCK_NODE_META:
+      if (type == STOCK_TOKEN_STRING)
+      {
+        return stock_parser_meta_set(parser, level->key, token);
+      }
+
+      if (type != STOCK_TOKEN_NUMBER)
+      {
+        return 0;
+      }
+
+      switch (level->key)
+      {
+        case STOCK_KEY_MARKET_VOLUME:
+          parser->volume     = stock_int_get(token);
+          parser->has_volume = true;
+          break;
+
+        case STOCK_KEY_MARKET_PRICE:
+          parser->market.price = stock_double_get(token);
+          break;
+
+        case STOCK_KEY_MARKET_HIGH:
+          parser->market.high = stock_double_get(token);
+          break;
+
+        case STOCK_KEY_MARKET_LOW:
+          parser->market.low = stock_double_get(token);
+          break;
+
+        default:
+          break;
+      }
+      return 0;
+
+    case STOCK_NODE_PERIOD:
+      if (type == STOCK_TOKEN_NUMBER && level->key == STOCK_KEY_START)
+      {
+        parser->market.start = stock_int_get(token);
+      }
+      else if (type == STOCK_TOKEN_NUMBER && level->key == STOCK_KEY_END)
+      {
+        parser->market.end = stock_int_get(token);
+      }
+      return 0;
+
+    case STOCK_NODE_COLUMN:
+      if (type == STOCK_TOKEN_NUMBER)
+      {
+        return stock_parser_column_set(parser, level->key, level->index, token);
+      }
+
+      return stock_parser_column_set(parser, level->key, level->index, NULL);
+
+    default:
+      return 0;
+  }
+}
+
+/*
+ * Get node of the value that begins at the current level
+ */
+static inline stock_node_t stock_parser_node_get(stock_parser_t* parser)
+{
+  if (parser->depth == 0)
+  {
+    return STOCK_NODE_ROOT;
+  }
+
+  stock_level_t* level = &parser->levels[parser->depth - 1];
+
+  switch (level->node)
+  {
+    case STOCK_NODE_ROOT:
+      return (level->key == STOCK_KEY_CHART) ? STOCK_NODE_CHART : STOCK_NODE_SKIP;
+
+    case STOCK_NODE_CHART:
+      return (level->key == STOCK_KEY_RESULT) ? STOCK_NODE_RESULTS : STOCK_NODE_SKIP;
+
+    case STOCK_NODE_RESULTS:
+      return (level->index == 0) ? STOCK_NODE_RESULT : STOCK_NODE_SKIP;
+
+    case STOCK_NODE_RESULT:
+      switch (level->key)
+      {
+        case STOCK_KEY_META:       return STOCK_NODE_META;
+        case STOCK_KEY_TIMESTAMP:  return STOCK_NODE_COLUMN;
+        case STOCK_KEY_INDICATORS: return STOCK_NODE_INDICATORS;
+        default:                   return STOCK_NODE_SKIP;
+      }
+
+    case STOCK_NODE_META:
+      return (level->key == STOCK_KEY_PERIOD) ? STOCK_NODE_PERIODS : STOCK_NODE_SKIP;
+
+    case STOCK_NODE_PERIODS:
+      return (level->key == STOCK_KEY_REGULAR) ? STOCK_NODE_PERIOD : STOCK_NODE_SKIP;
+
+    case STOCK_NODE_INDICATORS:
+      return (level->key == STOCK_KEY_QUOTE) ? STOCK_NODE_QUOTES : STOCK_NODE_SKIP;
+
+    case STOCK_NODE_QUOTES:
+      return (level->index == 0) ? STOCK_NODE_QUOTE : STOCK_NODE_SKIP;
+
+    case STOCK_NODE_QUOTE:
+      return stock_key_field_get(level->key) ? STOCK_NODE_COLUMN : STOCK_NODE_SKIP;
+
+    default:
+      return STOCK_NODE_SKIP;
+  }
+}
+
+/*
+ * Begin object or array
+ */
+static inline int stock_parser_begin(stock_parser_t* parser, bool is_object)
+{
+  if (parser->depth >= STOCK_PARSER_DEPTH)
+  {
+    return 1;
+  }
+
+  stock_node_t node = stock_parser_node_get(parser);
+
+  stock_key_t key = STOCK_KEY_NONE;
+
+  if (parser->depth > 0)
+  {
+    stock_level_t* level = &parser->levels[parser->depth - 1];
+
+    if (level->is_object && level->is_key)
+    {
+      return 2;
+    }
+
+    key = level->key;
+  }
+  else if (!is_object)
+  {
+    return 3;
+  }
+
+  switch (node)
+  {
+    case STOCK_NODE_RESULT:
+      parser->has_result = true;
+      break;
+
+    case STOCK_NODE_META:
+      parser->has_meta = true;
+      break;
+
+    case STOCK_NODE_COLUMN:
+      parser->fields |= stock_key_field_get(key);
+      break;
+
+    default:
+      break;
+  }
+
+  // Columns keep the key of their parent, to know what to store
+  parser->levels[parser->depth++] = (stock_level_t)
+  {
+    .node      = node,
+    .key       = (node == STOCK_NODE_COLUMN) ? key : STOCK_KEY_NONE,
+    .is_object = is_object,
+    .is_key    = is_object,
+  };
+
+  return 0;
+}
+
+/*
+ * End object or array
+ */
+static inline int stock_parser_end(stock_parser_t* parser, bool is_object)
+{
+  if (parser->depth == 0)
+  {
+    return 1;
+  }
+
+  stock_level_t* level = &parser->levels[parser->depth - 1];
+
+  if (level->is_object != is_object)
+  {
+    return 2;
+  }
+
+  parser->depth--;
+
+  if (parser->depth == 0)
+  {
+    parser->is_done = true;
+  }
+
+  return 0;
+}
+
+/*
+ * Handle complete string, either key or value
+ */
+static inline int stock_parser_string(stock_parser_t* parser)
+{
+  parser->token[parser->token_size] = '\0';
+
+  if (parser->depth > 0)
+  {
+    stock_level_t* level = &parser->levels[parser->depth - 1];
+
+    if (level->is_object && level->is_key)
+    {
+      level->key = (level->node == STOCK_NODE_SKIP) ? STOCK_KEY_NONE : stock_key_get(parser->token);
+
+      level->is_key = false;
+
+      return 0;
+    }
+  }
+
+  return stock_parser_scalar(parser, STOCK_TOKEN_STRING);
+}
+
+/*
+ * Handle complete literal, true, false or null
+ */
+static inline int stock_parser_literal(stock_parser_t* parser)
+{
+  parser->token[parser->token_size] = '\0';
+
+  if (strcmp(parser->token, "null") == 0)
+  {
+    return stock_parser_scalar(parser, STOCK_TOKEN_NULL);
+  }
+
+  if (strcmp(parser->token, "true") == 0)
+  {
+    return stock_parser_scalar(parser, STOCK_TOKEN_TRUE);
+  }
+
+  if (strcmp(parser->token, "false") == 0)
+  {
+    return stock_parser_scalar(parser, STOCK_TOKEN_FALSE);
+  }
+
+  return 1;
+}
+
+/*
+ * Handle character of escape sequence in string
+ */
+static inline int stock_parser_escape(stock_parser_t* parser, char symbol)
+{
+  parser->state = STOCK_LEX_STRING;
+
+  switch (symbol)
+  {
+    case '"':  return stock_parser_token_append(parser, '"');
+    case '\\': return stock_parser_token_append(parser, '\\');
+    case '/':  return stock_parser_token_append(parser, '/');
+    case 'b':  return stock_parser_token_append(parser, '\b');
+    case 'f':  return stock_parser_token_append(parser, '\f');
+    case 'n':  return stock_parser_token_append(parser, '\n');
+    case 'r':  return stock_parser_token_append(parser, '\r');
+    case 't':  return stock_parser_token_append(parser, '\t');
+
+    case 'u':
+      parser->state        = STOCK_LEX_UNICODE;
+      parser->unicode      = 0;
+      parser->unicode_size = 0;
+      return 0;
+
+    default:
+      return 1;
+  }
+}
+
+/*
+ * Handle hex digit of unicode escape sequence in string
+ */
+static inline int stock_parser_unicode(stock_parser_t* parser, char symbol)
+{
+  uint32_t digit;
+
+  if      (symbol >= '0' && symbol <= '9') digit = symbol - '0';
+  else if (symbol >= 'a' && symbol <= 'f') digit = symbol - 'a' + 10;
+  else if (symbol >= 'A' && symbol <= 'F') digit = symbol - 'A' + 10;
+  else return 1;
+
+  parser->unicode = (parser->unicode << 4) | digit;
+
+  if (++parser->unicode_size < 4)
+  {
+    return 0;
+  }
+
+  parser->state = STOCK_LEX_STRING;
+
+  uint32_t code = parser->unicode;
+
+  // High surrogate, wait for the low surrogate
+  if (code >= 0xD800 && code <= 0xDBFF)
+  {
+    parser->surrogate = code;
+
+    return 0;
+  }
+
+  if (code >= 0xDC00 && code <= 0xDFFF && parser->surrogate)
+  {
+    code = 0x10000 + ((parser->surrogate - 0xD800) << 10) + (code - 0xDC00);
+  }
+
+  parser->surrogate = 0;
+
+  return stock_parser_unicode_append(parser, code);
+}
+
+/*
+ * Move on to the next key or index, after a comma
+ */
+static inline int stock_parser_next(stock_parser_t* parser)
+{
+  if (parser->depth == 0)
+  {
+    return 1;
+  }
+
+  stock_level_t* level = &parser->levels[parser->depth - 1];
+
+  if (level->is_object)
+  {
+    level->is_key = true;
+  }
+  else
+  {
+    level->index++;
+  }
+
+  return 0;
+}
+
+/*
+ * Handle structural character or start of token
+ */
+static inline int stock_parser_value(stock_parser_t* parser, char symbol)
+{
+  switch (symbol)
+  {
+    case ' ': case '\t': case '\n': case '\r':
+      return 0;
+
+    case '{':
+      return stock_parser_begin(parser, true);
+
+    case '[':
+      return stock_parser_begin(parser, false);
+
+    case '}':
+      return stock_parser_end(parser, true);
+
+    case ']':
+      return stock_parser_end(parser, false);
+
+    case ':':
+      return 0;
+
+    case ',':
+      return stock_parser_next(parser);
+
+    case '"':
+      parser->state      = STOCK_LEX_STRING;
+      parser->token_size = 0;
+      parser->surrogate  = 0;
+      return 0;
+
+    default:
+      break;
+  }
+
+  parser->token_size = 0;
+
+  if (symbol == '-' || (symbol >= '0' && symbol <= '9'))
+  {
+    parser->state = STOCK_LEX_NUMBER;
+  }
+  else if (symbol >= 'a' && symbol <= 'z')
+  {
+    parser->state = STOCK_LEX_LITERAL;
+  }
+  else return 2;
+
+  return stock_parser_token_append(parser, symbol);
+}
+
+/*
+ * Feed chunk of the response to the parser
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Malformed or unexpected json
+ */
+static inline int stock_parser_feed(stock_parser_t* parser, const char* chunk, size_t size)
+{
+  size_t index = 0;
+
+  while (index < size)
+  {
+    char symbol = chunk[index];
+
+    int status = 0;
+
+    switch (parser->state)
+    {
+      case STOCK_LEX_VALUE:
+        status = stock_parser_value(parser, symbol);
+        break;
+
+      case STOCK_LEX_STRING:
+        if (symbol == '"')
+        {
+          parser->state = STOCK_LEX_VALUE;
+
+          status = stock_parser_string(parser);
+        }
+        else if (symbol == '\\')
+        {
+          parser->state = STOCK_LEX_ESCAPE;
+        }
+        else
+        {
+          status = stock_parser_token_append(parser, symbol);
+        }
+        break;
+
+      case STOCK_LEX_ESCAPE:
+        status = stock_parser_escape(parser, symbol);
+        break;
+
+      case STOCK_LEX_UNICODE:
+        status = stock_parser_unicode(parser, symbol);
+        break;
+
+      case STOCK_LEX_NUMBER:
+        if ((symbol >= '0' && symbol <= '9') || symbol == '.' ||
+            symbol == 'e' || symbol == 'E' || symbol == '-' || symbol == '+')
+        {
+          status = stock_parser_token_append(parser, symbol);
+        }
+        else
+        {
+          parser->token[parser->token_size] = '\0';
+
+          parser->state = STOCK_LEX_VALUE;
+
+          if (stock_parser_scalar(parser, STOCK_TOKEN_NUMBER) != 0)
+          {
+            return 1;
+          }
+
+          // The symbol after the number is handled as a new value
+          continue;
+        }
+        break;
+
+      case STOCK_LEX_LITERAL:
+        if (symbol >= 'a' && symbol <= 'z')
+        {
+          status = stock_parser_token_append(parser, symbol);
+        }
+        else
+        {
+          parser->state = STOCK_LEX_VALUE;
+
+          if (stock_parser_literal(parser) != 0)
+          {
+            return 1;
+          }
+
+          continue;
+        }
+        break;
+    }
+
+    if (status != 0)
+    {
+      return 1;
+    }
+
+    index++;
+  }
+
+  return 0;
+}
+
+/*
+ * Reset parser for a new response, keeping allocated buffers
+ */
+static inline void stock_parser_reset(stock_parser_t* parser)
+{
+  *parser = (stock_parser_t)
+  {
+    .metas          = parser->metas,
+    .token          = parser->token,
+    .token_capacity = parser->token_capacity,
+    .values         = parser->values,
+    .masks          = parser->masks,
+  };
+
+  parser->values.count = 0;
+
+  if (parser->masks)
+  {
+    memset(parser->masks, 0, sizeof(uint8_t) * parser->values.capacity);
+  }
+}
+
+/*
+ * Free parser and all of its buffers
+ */
+static inline void stock_parser_free(stock_parser_t* parser)
+{
+  stock_parser_reset(parser);
+
+  for (size_t index = 0; index < STOCK_META_COUNT; index++)
+  {
+    free(parser->metas.strings[index]);
+  }
+
+  free(parser->token);
+
+  stock_values_free(&parser->values);
+
+  free(parser->masks);
+
+  *parser = (stock_parser_t) { 0 };
+}
+
+/*
+ * Get the name of a missing column field, for error messages
+ */
+static inline const char* stock_field_name_get(int fields)
+{
+  if (!(fields & STOCK_FIELD_TIME))   return "timestamp";
+  if (!(fields & STOCK_FIELD_VOLUME)) return "volume";
+  if (!(fields & STOCK_FIELD_OPEN))   return "open";
+  if (!(fields & STOCK_FIELD_CLOSE))  return "close";
+  if (!(fields & STOCK_FIELD_HIGH))   return "high";
+
+  return "low";
+}
+
+/*
+ * Copy the parsed data of parser into stock
+ *
+ * Candles with a missing field are dropped, and the others are copied
+ * into values of their exact count. The values and masks of parser are
+ * kept for the next response, so they are only grown, never allocated
+ * again for every response
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Incomplete response
+ * - 2 | Missing result
+ * - 3 | Missing meta data
+ * - 4 | Missing column
+ * - 5 | Failed to allocate values
+ */
+static inline int stock_parser_take(stock_t* stock, stock_parser_t* parser)
+{
+  if (!parser->is_done)
+  {
+    error_print("Incomplete json response: %s", stock_string_get(stock->symbol));
+
+    return 1;
+  }
+
+  if (!parser->has_result)
+  {
+    error_print("Missing 'result' field: %s", stock_string_get(stock->symbol));
+
+    return 2;
+  }
+
+  if (!parser->has_meta)
+  {
+    error_print("Missing 'meta' field: %s", stock_string_get(stock->symbol));
+
+    return 3;
+  }
+
+  if (!parser->currency)
+  {
+    error_print("Missing 'currency' field: %s", stock_string_get(stock->symbol));
+
+    return 3;
+  }
+
+  if (parser->fields != STOCK_FIELD_ALL)
+  {
+    error_print("Missing quote '%s' field: %s", stock_field_name_get(parser->fields), stock_string_get(stock->symbol));
+
+    return 4;
+  }
+
+  stock->currency = stock_string_id_get(parser->currency);
+
+  if (parser->long_name)
+  {
+    stock->name = stock_string_id_get(parser->long_name);
+  }
+  else if (parser->short_name)
+  {
+    error_print("Missing 'longName' field: %s", stock_string_get(stock->symbol));
+
+    stock->name = stock_string_id_get(parser->short_name);
+  }
+  else
+  {
+    error_print("Missing 'shortName' field: %s", stock_string_get(stock->symbol));
+
+    stock->name = stock->symbol;
+  }
+
+  if (!parser->exchange)
+  {
+    error_print("Missing 'fullExchangeName' field: %s", stock_string_get(stock->symbol));
+  }
+
+  stock->exchange = stock_string_id_get(parser->exchange);
+
+  if (!parser->has_volume)
+  {
+    error_print("Missing 'regularMarketVolume' field: %s", stock_string_get(stock->symbol));
+  }
+
+  stock->volume = parser->volume;
+
+  stock->market = parser->market;
+
+  const stock_values_t* values = &parser->values;
+
+  size_t count = 0;
+
+  for (size_t index = 0; index < values->count; index++)
+  {
+    if (parser->masks[index] == STOCK_FIELD_ALL) count++;
+  }
+
+  stock_values_t copy = { 0 };
+
+  if (count > 0 && stock_values_reserve(&copy, count) != 0)
+  {
+    return 5;
+  }
+
+  // Copy the candles without missing fields
+  for (size_t index = 0; index < values->count; index++)
+  {
+    if (parser->masks[index] != STOCK_FIELD_ALL) continue;
+
+    copy.time[copy.count]   = values->time[index];
+    copy.volume[copy.count] = values->volume[index];
+    copy.high[copy.count]   = values->high[index];
+    copy.low[copy.count]    = values->low[index];
+    copy.close[copy.count]  = values->close[index];
+    copy.open[copy.count]   = values->open[index];
+
+    copy.count++;
+  }
+
+  stock->values = copy;
+
+  return 0;
+}
+
+#define STOCK_PATH_SIZE 4096
+
+/*
+ * Fetch backend, selected at runtime with stock_backend_set
+ *
+ * dir     - absolute path of the record directory
+ * latency - ms before a replayed response arrives
+ */
+typedef struct stock_backend_t
+{
+  stock_mode_t mode;
+  char         dir[STOCK_PATH_SIZE];
+  int          latency;
+} stock_backend_t;
+
+static stock_backend_t stock_backend = { .mode = STOCK_MODE_LIVE };
+
+/*
+ * Select where the stock data is fetched from
+ *
+ * The directory is created when recording, and has to exist when replaying
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Missing directory
+ * - 2 | Failed to create directory
+ * - 3 | Directory does not exist
+ */
+int stock_backend_set(stock_mode_t mode, const char* dir, int latency)
+{
+  if (mode == STOCK_MODE_LIVE)
+  {
+    stock_backend = (stock_backend_t) { .mode = mode };
+
+    return 0;
+  }
+
+  if (!dir)
+  {
+    return 1;
+  }
+
+  if (mode == STOCK_MODE_RECORD && mkdir(dir, 0755) != 0 && errno != EEXIST)
+  {
+    return 2;
+  }
+
+  char path[PATH_MAX];
+
+  if (!realpath(dir, path) || strlen(path) >= STOCK_PATH_SIZE)
+  {
+    return 3;
+  }
+
+  stock_backend = (stock_backend_t)
+  {
+    .mode    = mode,
+    .latency = MAX(latency, 0),
+  };
+
+  strcpy(stock_backend.dir, path);
+
+  return 0;
+}
+
+/*
+ * Percent-encode string into buffer of size bytes, keeping the ascii
+ * letters and digits and the characters in keep
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Buffer is too small
+ */
+static inline int stock_string_escape(char* buffer, size_t size, const char* string, const char* keep)
+{
+  const char* digits = "0123456789ABCDEF";
+
+  size_t length = 0;
+
+  for (; *string; string++)
+  {
+    unsigned char symbol = *string;
+
+    bool is_kept = (symbol >= 'a' && symbol <= 'z') ||
+                   (symbol >= 'A' && symbol <= 'Z') ||
+                   (symbol >= '0' && symbol <= '9') || strchr(keep, symbol);
+
+    if (length + (is_kept ? 1 : 3) >= size)
+    {
+      return 1;
+    }
+
+    if (is_kept)
+    {
+      buffer[length++] = symbol;
+    }
+    else
+    {
+      buffer[length++] = '%';
+      buffer[length++] = digits[symbol >> 4];
+      buffer[length++] = digits[symbol & 15];
+    }
+  }
+
+  buffer[length] = '\0';
+
+  return 0;
+}
+
+/*
+ * Characters of symbols that are kept in file names, the others are
+ * percent-encoded, so that symbols like ^DJI, EURUSD=X or a symbol with
+ * a slash are one file each, and _ only separates the parts of the name
+ */
+#define STOCK_NAME_KEEP "-."
+
+/*
+ * Create path of the saved response of a request
+ *
+ * The name is the percent-encoded symbol, the range or period, and the
+ * interval
+ */
+static inline char* stock_backend_path_create(const char* symbol, const char* range, const char* interval, int64_t period)
+{
+  char name[STOCK_PATH_SIZE];
+
+  if (stock_string_escape(name, sizeof(name), symbol, STOCK_NAME_KEEP) != 0)
+  {
+    return NULL;
+  }
+
+  char* path = malloc(sizeof(char) * STOCK_PATH_SIZE);
+
+  if (!path)
+  {
+    return NULL;
+  }
+
+  int status = (period > 0) ?
+    snprintf(path, STOCK_PATH_SIZE, "%s/%s_%lld_%s.json", stock_backend.dir, name, (long long) period, interval) :
+    snprintf(path, STOCK_PATH_SIZE, "%s/%s_%s_%s.json", stock_backend.dir, name, range, interval);
+
+  if (status < 0 || status >= STOCK_PATH_SIZE)
+  {
+    free(path);
+
+    return NULL;
+  }
+
+  return path;
+}
+
+/*
+ * Get current time in milliseconds
+ */
+static inline long stock_time_get(void)
+{
+  struct timespec time;
+
+  clock_gettime(CLOCK_MONOTONIC, &time);
+
+  return time.tv_sec * 1000 + time.tv_nsec / 1000000;
+}
+
+/*
+ * Get the time when a replayed response that is requested now arrives
+ *
+ * RETURN (long due)
+ * - 0  | The response arrives immediately
+ * - >0 | Time in milliseconds
+ */
+static inline long stock_replay_due_get(void)
+{
+  if (stock_backend.mode != STOCK_MODE_REPLAY || stock_backend.latency == 0)
+  {
+    return 0;
+  }
+
+  return stock_time_get() + stock_backend.latency;
+}
+
+/*
+ * Response of request, parsed as the bytes arrive
+ *
+ * The chart parser is used by default, the json-c tokener is the fallback
+ * for responses that the chart parser does not understand
+ *
+ * Both are reused between requests, only their state is reset
+ *
+ * record - file that the bytes are saved to, when recording
+ */
+typedef struct stock_response_t
+{
+  stock_parser_t       parser;
+  struct json_tokener* tokener;
+  struct json_object*  json;
+  bool                 is_json;
+  FILE*                record;
+  char*                record_path;
+} stock_response_t;
+
+/*
+ * Start recording the bytes of response to a file in the record directory
+ *
+ * The bytes are written to a temporary file, that is renamed when
+ * the response is complete
+ *
+ * RETURN (int status)
+ * - 0 | Success, or not recording
+ * - 1 | Failed to create path
+ * - 2 | Failed to open file
+ */
+static inline int stock_record_start(stock_response_t* response, const char* symbol, const char* range, const char* interval, int64_t period)
+{
+  if (stock_backend.mode != STOCK_MODE_RECORD)
+  {
+    return 0;
+  }
+
+  char* path = stock_backend_path_create(symbol, range, interval, period);
+
+  if (!path)
+  {
+    return 1;
+  }
+
+  char temp_path[STOCK_PATH_SIZE + 4];
+
+  sprintf(temp_path, "%s.tmp", path);
+
+  FILE* file = fopen(temp_path, "wb");
+
+  if (!file)
+  {
+    error_print("Failed to open record file: %s", temp_path);
+
+    free(path);
+
+    return 2;
+  }
+
+  response->record      = file;
+  response->record_path = path;
+
+  return 0;
+}
+
+/*
+ * Stop recording response, only keeping the file if the response is complete
+ */
+static inline void stock_record_stop(stock_response_t* response, bool is_complete)
+{
+  if (!response->record) return;
+
+  fclose(response->record);
+
+  char temp_path[STOCK_PATH_SIZE + 4];
+
+  sprintf(temp_path, "%s.tmp", response->record_path);
+
+  if (!is_complete || rename(temp_path, response->record_path) != 0)
+  {
+    remove(temp_path);
+  }
+
+  free(response->record_path);
+
+  response->record      = NULL;
+  response->record_path = NULL;
+}
+
+/*
+ * Clear response, keeping the parsers for the next request
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to create tokener
+ */
+static inline int stock_response_clear(stock_response_t* response)
+{
+  stock_parser_reset(&response->parser);
+
+  // The response is fetched again, so record it from the start
+  if (response->record)
+  {
+    rewind(response->record);
+
+    if (ftruncate(fileno(response->record), 0) != 0)
+    {
+      stock_record_stop(response, false);
+    }
+  }
+
+  if (response->json)
+  {
+    json_object_put(response->json);
+
+    response->json = NULL;
+  }
+
+  if (!response->is_json)
+  {
+    return 0;
+  }
+
+  if (!response->tokener)
+  {
+    response->tokener = json_tokener_new();
+
+    return response->tokener ? 0 : 1;
+  }
+
+  json_tokener_reset(response->tokener);
+
+  return 0;
+}
+
+/*
+ * Free parsed data and parsers of response
+ */
+static inline void stock_response_free(stock_response_t* response)
+{
+  stock_record_stop(response, false);
+
+  stock_parser_free(&response->parser);
+
+  if (response->json)
+  {
+    json_object_put(response->json);
+  }
+
+  if (response->tokener)
+  {
+    json_tokener_free(response->tokener);
+  }
+
+  *response = (stock_response_t) { 0 };
+}
+
+/*
+ * Function for curl to write response, feeding the bytes to the parser
+ *
+ * Returning less than total_size makes curl abort the transfer
+ */
+static inline size_t stock_response_write(void* ptr, size_t size, size_t nmemb, stock_response_t* response)
+{
+  size_t total_size = size * nmemb;
+
+  if (response->record && fwrite(ptr, 1, total_size, response->record) != total_size)
+  {
+    error_print("Failed to record response");
+
+    stock_record_stop(response, false);
+  }
+
+  if (!response->is_json)
+  {
+    if (stock_parser_feed(&response->parser, ptr, total_size) != 0)
+    {
+      error_print("Unexpected chart response, falling back to json-c");
+
+      return 0;
+    }
+
+    return total_size;
+  }
+
+  // Ignore trailing bytes after a complete json object
+  if (response->json)
+  {
+    return total_size;
+  }
+
+  response->json = json_tokener_parse_ex(response->tokener, ptr, total_size);
+
+  if (!response->json && json_tokener_get_error(response->tokener) != json_tokener_continue)
+  {
+    error_print("json_tokener_parse_ex: %s", json_tokener_error_desc(json_tokener_get_error(response->tokener)));
+
+    return 0;
+  }
+
+  return total_size;
+}
+
+#define STOCK_URL_SIZE 256
+#define STOCK_URL_BASE "https://query1.finance.yahoo.com/v8/finance/chart/"
+
+/*
+ * Create url for fetching stock data
+ *
+ * If period is set, only the values from that time until now are fetched,
+ * instead of the whole range
+ */
+static inline char* stock_url_create(const char* symbol, const char* range, const char* interval, int64_t period)
+{
+  if (!symbol)
+  {
+    return NULL;
+  }
+
+  // Replayed responses are read by curl from the record directory
+  if (stock_backend.mode == STOCK_MODE_REPLAY)
+  {
+    char* path = stock_backend_path_create(symbol, range, interval, period);
+
+    if (!path)
+    {
+      return NULL;
+    }
+
+    // Curl decodes the path of the url, so the % of the name is encoded
+    size_t size = strlen(path) * 3 + 8;
+
+    char* url = malloc(sizeof(char) * size);
+
+    if (url)
+    {
+      strcpy(url, "file://");
+
+      stock_string_escape(url + 7, size - 7, path, "-._~/");
+    }
+
+    free(path);
+
+    return url;
+  }
+
+  char* url = malloc(sizeof(char) * STOCK_URL_SIZE);
+
+  if (!url)
+  {
+    return NULL;
+  }
+
+  if (sprintf(url,"%s%s?", STOCK_URL_BASE, symbol) < 0)
+  {
+    free(url);
+
+    return NULL;
+  }
+
+  if (period > 0)
+  {
+    if (sprintf(url + strlen(url), "period1=%lld&period2=%lld&", (long long) period, (long long) time(NULL)) < 0)
+    {
+      free(url);
+
+      return NULL;
+    }
+  }
+  else if (range && sprintf(url + strlen(url), "range=%s&", range) < 0)
+  {
+    free(url);
+
+    return NULL;
+  }
+
+  if (interval && sprintf(url + strlen(url), "interval=%s&", interval) < 0)
+  {
+    free(url);
+
+    return NULL;
+  }
+
+  return url;
+}
+
+#define STOCK_CURL_HEADER "Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/58.0.3029.110 Safari/537.3"
+
+/*
+ * Curl context, shared by every request during the lifetime of the process
+ *
+ * share - DNS cache, TLS sessions and connection cache
+ * easy  - reused handle, keeps the connection to yahoo alive
+ * multi - handle for running many requests concurrently
+ * response - reused response of easy handle
+ */
+typedef struct stock_curl_t
+{
+  CURLSH*          share;
+  CURL*            easy;
+  CURLM*           multi;
+  stock_response_t response;
+  bool             is_init;
+} stock_curl_t;
+
+static stock_curl_t stock_curl = { 0 };
+
+static inline void stock_async_free(void);
+
+static inline void stock_cache_free(void);
+
+static inline void stock_index_free(void);
+
+static inline size_t stock_disk_flush(size_t limit, bool is_durable);
+
+/*
+ * Initialize curl context, only the first call does anything
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to initialize curl
+ * - 2 | Failed to create share handle
+ * - 3 | Failed to create easy handle
+ * - 4 | Failed to create multi handle
+ */
+int stock_init(void)
+{
+  if (stock_curl.is_init)
+  {
+    return 0;
+  }
+
+  if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK)
+  {
+    return 1;
+  }
+
+  CURLSH* share = curl_share_init();
+
+  if (!share)
+  {
+    curl_global_cleanup();
+
+    return 2;
+  }
+
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+
+  curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+
+  CURL* easy = curl_easy_init();
+
+  if (!easy)
+  {
+    curl_share_cleanup(share);
+
+    curl_global_cleanup();
+
+    return 3;
+  }
+
+  curl_easy_setopt(easy, CURLOPT_SHARE, share);
+
+  curl_easy_setopt(easy, CURLOPT_USERAGENT, STOCK_CURL_HEADER);
+
+  curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, stock_response_write);
+
+  curl_easy_setopt(easy, CURLOPT_TCP_KEEPALIVE, 1L);
+
+  CURLM* multi = curl_multi_init();
+
+  if (!multi)
+  {
+    curl_easy_cleanup(easy);
+
+    curl_share_cleanup(share);
+
+    curl_global_cleanup();
+
+    return 4;
+  }
+
+  curl_multi_setopt(multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+  stock_curl = (stock_curl_t)
+  {
+    .share   = share,
+    .easy    = easy,
+    .multi   = multi,
+    .is_init = true,
+  };
+
+  return 0;
+}
+
+/*
+ * Cleanup curl context, closing all kept alive connections
+ *
+ * The dirty stocks are written to the disk cache first, synced to disk
+ */
+void stock_quit(void)
+{
+  if (!stock_curl.is_init) return;
+
+  stock_disk_flush(0, true);
+
+  stock_async_free();
+
+  stock_cache_free();
+
+  stock_index_free();
+
+  stock_strings_free();
+
+  curl_multi_cleanup(stock_curl.multi);
+
+  curl_easy_cleanup(stock_curl.easy);
+
+  stock_response_free(&stock_curl.response);
+
+  curl_share_cleanup(stock_curl.share);
+
+  curl_global_cleanup();
+
+  stock_curl = (stock_curl_t) { 0 };
+}
+
+/*
+ * Get curl response for a stock
+ *
+ * The response is owned by the curl context and valid until the next request
+ */
+static inline stock_response_t* stock_response_get(const char* symbol, const char* range, const char* interval, int64_t period)
+{
+  if (stock_init() != 0)
+  {
+    return NULL;
+  }
+
+  char* url = stock_url_create(symbol, range, interval, period);
+
+  if (!url)
+  {
+    return NULL;
+  }
+
+  stock_response_t* response = &stock_curl.response;
+
+  response->is_json = false;
+
+  if (stock_response_clear(response) != 0)
+  {
+    free(url);
+
+    return NULL;
+  }
+
+  stock_record_start(response, symbol, range, interval, period);
+
+  CURL* curl = stock_curl.easy;
+
+  curl_easy_setopt(curl, CURLOPT_URL, url);
+
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, response);
+
+  if (stock_backend.mode == STOCK_MODE_REPLAY && stock_backend.latency > 0)
+  {
+    usleep(stock_backend.latency * 1000);
+  }
+
+  CURLcode res = curl_easy_perform(curl);
+
+  // Retry with json-c if the chart parser did not understand the response
+  if (res == CURLE_WRITE_ERROR && !response->is_json)
+  {
+    response->is_json = true;
+
+    if (stock_response_clear(response) == 0)
+    {
+      res = curl_easy_perform(curl);
+    }
+  }
+
+  stock_record_stop(response, res == CURLE_OK);
+
+  free(url);
+
+  if (res == CURLE_OK)
+  {
+    return response;
+  }
+
+  return NULL;
+}
+
+/*
+ * Parse stock name, either longName or shortName, or symbol
+ */
+static inline int stock_name_parse(stock_t* stock, struct json_object* meta)
+{
+  struct json_object* name = json_object_object_get(meta, "longName");
+
+  if (name && json_object_is_type(name, json_type_string))
+  {
+    stock->name = stock_string_id_get(json_object_get_string(name));
+
+    return 0;
+  }
+
+  error_print("Missing 'longName' field: %s", stock_string_get(stock->symbol));
+
+
+  name = json_object_object_get(meta, "shortName");
+
+  if (name && json_object_is_type(name, json_type_string))
+  {
+    stock->name = stock_string_id_get(json_object_get_string(name));
+
+    return 0;
+  }
+
+  error_print("Missing 'shortName' field: %s", stock_string_get(stock->symbol));
+
+
+  stock->name = stock->symbol;
+
+  return 1;
+}
+
+/*
+ * Get double of field in json object, or 0 if it is missing
+ */
+static inline double stock_json_double_get(struct json_object* object, const char* key)
+{
+  struct json_object* field = json_object_object_get(object, key);
+
+  if (!field || !(json_object_is_type(field, json_type_double) || json_object_is_type(field, json_type_int)))
+  {
+    return 0;
+  }
+
+  return json_object_get_double(field);
+}
+
+/*
+ * Parse market data of the current trading day
+ */
+static inline void stock_market_parse(stock_market_t* market, struct json_object* meta)
+{
+  market->price = stock_json_double_get(meta, "regularMarketPrice");
+  market->high  = stock_json_double_get(meta, "regularMarketDayHigh");
+  market->low   = stock_json_double_get(meta, "regularMarketDayLow");
+
+  struct json_object* period = json_object_object_get(meta, "currentTradingPeriod");
+
+  struct json_object* regular = period ? json_object_object_get(period, "regular") : NULL;
+
+  if (regular)
+  {
+    market->start = stock_json_double_get(regular, "start");
+    market->end   = stock_json_double_get(regular, "end");
+  }
+}
+
+/*
+ * Parse stock meta data
+ */
+static inline int stock_meta_parse(stock_t* stock, struct json_object* result)
+{
+  struct json_object* meta = json_object_object_get(result, "meta");
+
+  if (!meta)
+  {
+    error_print("Missing 'meta' field: %s", stock_string_get(stock->symbol));
+
+    return 1;
+  }
+
+
+  struct json_object* currency = json_object_object_get(meta, "currency");
+
+  if (!currency || !json_object_is_type(currency, json_type_string))
+  {
+    error_print("Missing 'currency' field: %s", stock_string_get(stock->symbol));
+
+    return 3;
+  }
+
+  stock->currency = stock_string_id_get(json_object_get_string(currency));
+
+
+  if (stock_name_parse(stock, meta) != 0)
+  {
+    error_print("Failed to parse stock name");
+  }
+
+
+  struct json_object* exchange = json_object_object_get(meta, "fullExchangeName");
+
+  if (!exchange || !json_object_is_type(exchange, json_type_string))
+  {
+    error_print("Missing 'fullExchangeName' field: %s", stock_string_get(stock->symbol));
+  }
+
+  stock->exchange = stock_string_id_get(json_object_get_string(exchange));
+
+
+  struct json_object* volume = json_object_object_get(meta, "regularMarketVolume");
+
+  if (!volume || !json_object_is_type(volume, json_type_int))
+  {
+    error_print("Missing 'regularMarketVolume' field: %s", stock_string_get(stock->symbol));
+  }
+
+  stock->volume = json_object_get_int(volume);
+
+
+  stock_market_parse(&stock->market, meta);
+
+  return 0;
+}
+
+/*
+ * Parse json objects for stock value
+ */
+static inline int stock_value_parse(stock_value_t* value, struct json_object* time, struct json_object* volume, struct json_object* open, struct json_object* close, struct json_object* high, struct json_object* low)
+{
+  if (!time || !json_object_is_type(time, json_type_int))
+  {
+    return 1;
+  }
+
+  value->time = json_object_get_int64(time);
+
+
+  if (!volume || !json_object_is_type(volume, json_type_int))
+  {
+    return 2;
+  }
+
+  value->volume = json_object_get_int64(volume);
+
+
+  if (!open || !json_object_is_type(open, json_type_double))
+  {
+    return 3;
+  }
+
+  value->open = json_object_get_double(open);
+
+
+  if (!close || !json_object_is_type(close, json_type_double))
+  {
+    return 4;
+  }
+
+  value->close = json_object_get_double(close);
+
+
+  if (!high || !json_object_is_type(high, json_type_double))
+  {
+    return 5;
+  }
+
+  value->high = json_object_get_double(high);
+
+
+  if (!low || !json_object_is_type(low, json_type_double))
+  {
+    return 6;
+  }
+
+  value->low = json_object_get_double(low);
+
+  return 0;
+}
+
+/*
+ * Parse stock values
+ */
+static inline int stock_values_parse(stock_t* stock, struct json_object* result)
+{
+  struct json_object* indicators = json_object_object_get(result, "indicators");
+
+  if (!indicators)
+  {
+    error_print("Missing 'indicators' field: %s", stock_string_get(stock->symbol));
+
+    return 1;
+  }
+
+
+  struct json_object* quote = json_object_object_get(indicators, "quote");
+
+  if (!quote || !json_object_is_type(quote, json_type_array))
+  {
+    error_print("Missing 'quote' field: %s", stock_string_get(stock->symbol));
+
+    return 2;
+  }
+
+  quote = json_object_array_get_idx(quote, 0);
+
+
+  struct json_object* time = json_object_object_get(result, "timestamp");
+
+  if (!time || !json_object_is_type(time, json_type_array))
+  {
+    error_print("Missing 'timestamp' field: %s", stock_string_get(stock->symbol));
+
+    return 3;
+  }
+
+
+  struct json_object* volume = json_object_object_get(quote, "volume");
+
+  if (!volume || !json_object_is_type(volume, json_type_array))
+  {
+    error_print("Missing quote 'volume' field: %s", stock_string_get(stock->symbol));
+
+    return 4;
+  }
+
+
+  struct json_object* open = json_object_object_get(quote, "open");
+
+  if (!open || !json_object_is_type(open, json_type_array))
+  {
+    error_print("Missing quote 'open' field: %s", stock_string_get(stock->symbol));
+
+    return 5;
+  }
+
+
+  struct json_object* close = json_object_object_get(quote, "close");
+
+  if (!close || !json_object_is_type(close, json_type_array))
+  {
+    error_print("Missing quote 'close' field: %s", stock_string_get(stock->symbol));
+
+    return 6;
+  }
+
+
+  struct json_object* high = json_object_object_get(quote, "high");
+
+  if (!high || !json_object_is_type(high, json_type_array))
+  {
+    error_print("Missing quote 'high' field: %s", stock_string_get(stock->symbol));
+
+    return 7;
+  }
+
+
+  struct json_object* low = json_object_object_get(quote, "low");
+
+  if (!low || !json_object_is_type(low, json_type_array))
+  {
+    error_print("Missing quote 'low' field: %s", stock_string_get(stock->symbol));
+
+    return 8;
+  }
+
+  size_t count = json_object_array_length(open);
+
+  stock_values_t* values = &stock->values;
+
+  *values = (stock_values_t) { 0 };
+
+  if (stock_values_reserve(values, count) != 0)
+  {
+    error_print("Failed to malloc stock values");
+
+    return 9;
+  }
+
+  for (size_t index = 0; index < count; index++)
+  {
+    stock_value_t value;
+
+    if (stock_value_parse(&value,
+      json_object_array_get_idx(time, index),
+      json_object_array_get_idx(volume, index),
+      json_object_array_get_idx(open, index),
+      json_object_array_get_idx(close, index),
+      json_object_array_get_idx(high, index),
+      json_object_array_get_idx(low, index)
+    ) == 0)
+    {
+      values->time[values->count]   = value.time;
+      values->volume[values->count] = value.volume;
+      values->high[values->count]   = value.high;
+      values->low[values->count]    = value.low;
+      values->close[values->count]  = value.close;
+      values->open[values->count]   = value.open;
+
+      values->count++;
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Parse json object and store the data in stock
+ *
+ * The json object is released
+ */
+static inline int stock_json_parse(stock_t* stock, struct json_object* json)
+{
+  if (!json)
+  {
+    error_print("Incomplete json response: %s", stock_string_get(stock->symbol));
+
+    return 1;
+  }
+
+  struct json_object* chart = json_object_object_get(json, "chart");
+
+  if (!chart)
+  {
+    error_print("Missing 'chart' field: %s", stock_string_get(stock->symbol));
+
+    json_object_put(json);
+
+    return 2;
+  }
+
+  struct json_object* result = json_object_object_get(chart, "result");
+
+  if (!result || !json_object_is_type(result, json_type_array))
+  {
+    error_print("Missing 'result' field: %s", stock_string_get(stock->symbol));
+
+    json_object_put(json);
+
+    return 3;
+  }
+
+  result = json_object_array_get_idx(result, 0);
+
+  if (stock_meta_parse(stock, result) != 0)
+  {
+    json_object_put(json);
+
+    return 4;
+  }
+
+  if (stock_values_parse(stock, result) != 0)
+  {
+    json_object_put(json);
+
+    return 5;
+  }
+
+  json_object_put(json);
+
+  return 0;
+}
+
+/*
+ * Parse curl response and store the data in stock
+ */
+static inline int stock_response_parse(stock_t* stock, stock_response_t* response)
+{
+  int status;
+
+  if (!response->is_json)
+  {
+    status = stock_parser_take(stock, &response->parser);
+  }
+  else
+  {
+    struct json_object* json = response->json;
+
+    response->json = NULL;
+
+    status = stock_json_parse(stock, json);
+  }
+
+  if (status == 0)
+  {
+    stock->fetch_time = time(NULL);
+  }
+
+  return status;
+}
+
+/*
+ * Get stock data from the internet
+ */
+static inline int stock_fetch(stock_t* stock)
+{
+  stock_response_t* response = stock_response_get(stock_string_get(stock->symbol), stock_string_get(stock->range), stock_string_get(stock->interval), 0);
+
+  if (!response)
+  {
+    return 1;
+  }
+
+  if (stock_response_parse(stock, response) != 0)
+  {
+    return 2;
+  }
+
+  return 0;
+}
+
+/*
+ * Transfer of one stock in a concurrent batch
+ *
+ * due - time when a replayed transfer is added to the multi handle
+ */
+typedef struct stock_transfer_t
+{
+  CURL*            easy;
+  stock_t*         stock;
+  stock_response_t response;
+  char*            url;
+  size_t           index;
+  long             due;
+} stock_transfer_t;
+
+/*
+ * Start transfer of stock by adding it to the multi handle
+ */
+static inline int stock_transfer_start(stock_transfer_t* transfer, stock_t* stock, size_t index)
+{
+  char* url = stock_url_create(stock_string_get(stock->symbol), stock_string_get(stock->range), stock_string_get(stock->interval), 0);
+
+  if (!url)
+  {
+    return 1;
+  }
+
+  transfer->response.is_json = false;
+
+  if (stock_response_clear(&transfer->response) != 0)
+  {
+    free(url);
+
+    return 2;
+  }
+
+  stock_record_start(&transfer->response, stock_string_get(stock->symbol), stock_string_get(stock->range), stock_string_get(stock->interval), 0);
+
+  curl_easy_setopt(transfer->easy, CURLOPT_URL, url);
+
+  curl_easy_setopt(transfer->easy, CURLOPT_WRITEDATA, &transfer->response);
+
+  curl_easy_setopt(transfer->easy, CURLOPT_PRIVATE, transfer);
+
+  transfer->due = stock_replay_due_get();
+
+  if (transfer->due == 0 && curl_multi_add_handle(stock_curl.multi, transfer->easy) != CURLM_OK)
+  {
+    stock_record_stop(&transfer->response, false);
+
+    free(url);
+
+    return 3;
+  }
+
+  transfer->stock = stock;
+  transfer->url   = url;
+  transfer->index = index;
+
+  return 0;
+}
+
+/*
+ * Stop transfer, keeping the response tokener for the next transfer
+ */
+static inline void stock_transfer_stop(stock_transfer_t* transfer)
+{
+  curl_multi_remove_handle(stock_curl.multi, transfer->easy);
+
+  stock_record_stop(&transfer->response, false);
+
+  free(transfer->url);
+
+  transfer->stock = NULL;
+  transfer->url   = NULL;
+}
+
+#define STOCK_MULTI_LIMIT 8
+
+/*
+ * Fetch many stocks concurrently, like stock_fetch
+ *
+ * At most limit requests are in flight at once (0 means STOCK_MULTI_LIMIT)
+ *
+ * statuses[index] is the status of stocks[index], 0 on success,
+ * stocks that are NULL are skipped
+ *
+ * RETURN (size_t fetched_count)
+ */
+static inline size_t stock_fetch_many(stock_t** stocks, int* statuses, size_t count, size_t limit)
+{
+  for (size_t index = 0; index < count; index++)
+  {
+    statuses[index] = 1;
+  }
+
+  if (count == 0 || stock_init() != 0)
+  {
+    return 0;
+  }
+
+  if (limit == 0)
+  {
+    limit = STOCK_MULTI_LIMIT;
+  }
+
+  limit = MIN(limit, count);
+
+  stock_transfer_t* transfers = malloc(sizeof(stock_transfer_t) * limit);
+
+  if (!transfers)
+  {
+    return 0;
+  }
+
+  size_t transfer_count = 0;
+
+  for (; transfer_count < limit; transfer_count++)
+  {
+    CURL* easy = curl_easy_duphandle(stock_curl.easy);
+
+    if (!easy) break;
+
+    transfers[transfer_count] = (stock_transfer_t) { .easy = easy };
+  }
+
+  size_t fetched_count = 0;
+
+  size_t next_index = 0;
+
+  size_t active_count = 0;
+
+  int running;
+
+  do
+  {
+    // Fill idle transfers with the next stocks
+    for (size_t index = 0; index < transfer_count && next_index < count; index++)
+    {
+      stock_transfer_t* transfer = &transfers[index];
+
+      if (transfer->stock) continue;
+
+      stock_t* stock = stocks[next_index];
+
+      if (stock && stock_transfer_start(transfer, stock, next_index) == 0)
+      {
+        active_count++;
+      }
+
+      next_index++;
+    }
+
+    // Add the replayed transfers whose latency has passed
+    long now = stock_time_get();
+
+    long timeout = 1000;
+
+    bool is_waiting = false;
+
+    for (size_t index = 0; index < transfer_count; index++)
+    {
+      stock_transfer_t* transfer = &transfers[index];
+
+      if (!transfer->stock || transfer->due == 0) continue;
+
+      if (now < transfer->due)
+      {
+        timeout = MIN(timeout, transfer->due - now);
+
+        is_waiting = true;
+      }
+      else if (curl_multi_add_handle(stock_curl.multi, transfer->easy) == CURLM_OK)
+      {
+        transfer->due = 0;
+      }
+      else
+      {
+        statuses[transfer->index] = 3;
+
+        stock_transfer_stop(transfer);
+
+        active_count--;
+      }
+    }
+
+    if (curl_multi_perform(stock_curl.multi, &running) != CURLM_OK)
+    {
+      break;
+    }
+
+    CURLMsg* message;
+
+    int message_count;
+
+    while ((message = curl_multi_info_read(stock_curl.multi, &message_count)))
+    {
+      if (message->msg != CURLMSG_DONE) continue;
+
+      stock_transfer_t* transfer = NULL;
+
+      curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char**) &transfer);
+
+      if (!transfer || !transfer->stock) continue;
+
+      // Restart with json-c if the chart parser did not understand the response
+      if (message->data.result == CURLE_WRITE_ERROR && !transfer->response.is_json)
+      {
+        curl_multi_remove_handle(stock_curl.multi, transfer->easy);
+
+        transfer->response.is_json = true;
+
+        if (stock_response_clear(&transfer->response) == 0 &&
+            curl_multi_add_handle(stock_curl.multi, transfer->easy) == CURLM_OK)
+        {
+          continue;
+        }
+      }
+
+      stock_record_stop(&transfer->response, message->data.result == CURLE_OK);
+
+      if (message->data.result == CURLE_OK &&
+          stock_response_parse(transfer->stock, &transfer->response) == 0)
+      {
+        statuses[transfer->index] = 0;
+
+        fetched_count++;
+      }
+      else
+      {
+        error_print("Failed to fetch stock: %s", stock_string_get(transfer->stock->symbol));
+
+        statuses[transfer->index] = 2;
+      }
+
+      stock_transfer_stop(transfer);
+
+      active_count--;
+    }
+
+    if (running > 0 || is_waiting)
+    {
+      curl_multi_poll(stock_curl.multi, NULL, 0, timeout, NULL);
+    }
+  }
+  while (active_count > 0 || (next_index < count && transfer_count > 0));
+
+  for (size_t index = 0; index < transfer_count; index++)
+  {
+    stock_transfer_t* transfer = &transfers[index];
+
+    if (transfer->stock)
+    {
+      stock_transfer_stop(transfer);
+    }
+
+    curl_easy_cleanup(transfer->easy);
+
+    stock_response_free(&transfer->response);
+  }
+
+  free(transfers);
+
+  return fetched_count;
+}
+
+/*
+ * Free data of stock
+ *
+ * The strings are interned, so they are not freed with the stock
+ */
+static inline void stock_data_free(stock_t* stock)
+{
+  stock_values_free(&stock->values);
+
+  stock_values_free(&stock->_values);
+
+  stock_pyramid_free(&stock->_pyramid);
+
+  stock_lines_free(&stock->_indicators);
+
+  stock_lines_free(&stock->_lines);
+}
+
+/*
+ * Replace the data of stock with the data of copy
+ *
+ * The stock pointer stays the same, so windows keep showing it
+ */
+static inline void stock_data_swap(stock_t* stock, stock_t* copy)
+{
+  copy->version = stock->version + 1;
+
+  stock_data_free(stock);
+
+  *stock = *copy;
+}
+
+/*
+ * Copy 1d meta data of day stock to stock
+ */
+static inline void stock_day_copy(stock_t* stock, const stock_t* day)
+{
+  stock->high  = day->high;
+  stock->low   = day->low;
+  stock->open  = day->open;
+  stock->close = day->close;
+  stock->start = day->start;
+  stock->end   = day->end;
+}
+
+/*
+ * Header of a stock file in the disk cache
+ *
+ * The value columns follow the header, in the order of stock_values_t,
+ * and the strings follow the values
+ *
+ * A file holds one range of a symbol, at whatever interval it was last
+ * fetched with, so the interval is one of the strings
+ */
+typedef struct stock_disk_t
+{
+  int            magic;
+  int            value_size;
+  size_t         value_count;
+  int64_t        fetch_time;
+  int            volume;
+  int64_t        start;
+  int64_t        end;
+  double         open;
+  double         close;
+  double         high;
+  double         low;
+  stock_market_t market;
+  int            name_size;
+  int            exchange_size;
+  int            currency_size;
+  int            interval_size;
+} stock_disk_t;
+
+#define STOCK_DISK_MAGIC 0x344b5453 // "STK4"
+
+#define STOCK_DISK_NAME_SIZE 128
+
+static char stock_disk_dir[STOCK_PATH_SIZE] = { 0 };
+
+/*
+ * Set directory of the disk cache, creating it if it does not exist
+ *
+ * Stocks are only written to and read from disk if this is set
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Path is too long
+ * - 2 | Failed to create directory
+ */
+int stock_disk_dir_set(const char* dir)
+{
+  if (strlen(dir) >= STOCK_PATH_SIZE)
+  {
+    return 1;
+  }
+
+  if (mkdir(dir, 0755) != 0 && errno != EEXIST)
+  {
+    return 2;
+  }
+
+  strcpy(stock_disk_dir, dir);
+
+  return 0;
+}
+
+/*
+ * Get name of the file of range of symbol in the disk cache
+ *
+ * The symbol is percent-encoded like in the record directory
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Name is too long
+ */
+static inline int stock_disk_name_get(char* name, const char* symbol, const char* range)
+{
+  char escaped[STOCK_DISK_NAME_SIZE];
+
+  if (stock_string_escape(escaped, sizeof(escaped), symbol, STOCK_NAME_KEEP) != 0)
+  {
+    return 1;
+  }
+
+  int size = snprintf(name, STOCK_DISK_NAME_SIZE, "%s_%s.bin", escaped, range);
+
+  return (size < 0 || size >= STOCK_DISK_NAME_SIZE) ? 1 : 0;
+}
+
+/*
+ * Get length of string, or 0 if it is NULL
+ */
+static inline int stock_disk_string_size_get(const char* string)
+{
+  return string ? strlen(string) : 0;
+}
+
+/*
+ * Copy size bytes of string to pointer, nothing if size is 0
+ *
+ * A missing string is NULL, which memcpy must not get even for 0 bytes
+ *
+ * RETURN (char* pointer)
+ * - Pointer right after the copied string
+ */
+static inline char* stock_disk_string_copy(char* pointer, const char* string, int size)
+{
+  if (size > 0)
+  {
+    memcpy(pointer, string, size);
+  }
+
+  return pointer + size;
+}
+
+/*
+ * Write the data of stock to the disk cache
+ *
+ * If is_durable is true, the file is on disk when this returns. Else it
+ * is only replaced, which is enough for the file to survive the process
+ * being killed. A file that was cut short by a power loss is rejected
+ * by stock_disk_read
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | No disk cache, or no values
+ * - 2 | Bad file name
+ * - 3 | Failed to allocate memory
+ * - 4 | Failed to write file
+ */
+static inline int stock_disk_write(const stock_t* stock, bool is_durable)
+{
+  const stock_values_t* values = &stock->values;
+
+  if (!stock_disk_dir[0] || values->count == 0)
+  {
+    return 1;
+  }
+
+  char name[STOCK_DISK_NAME_SIZE];
+
+  if (stock_disk_name_get(name, stock_string_get(stock->symbol), stock_string_get(stock->range)) != 0)
+  {
+    return 2;
+  }
+
+  stock_disk_t header = (stock_disk_t)
+  {
+    .magic         = STOCK_DISK_MAGIC,
+    .value_size    = STOCK_VALUE_SIZE,
+    .value_count   = values->count,
+    .fetch_time    = stock->fetch_time,
+    .volume        = stock->volume,
+    .start         = stock->start,
+    .end           = stock->end,
+    .open          = stock->open,
+    .close         = stock->close,
+    .high          = stock->high,
+    .low           = stock->low,
+    .market        = stock->market,
+    .name_size     = stock_disk_string_size_get(stock_string_get(stock->name)),
+    .exchange_size = stock_disk_string_size_get(stock_string_get(stock->exchange)),
+    .currency_size = stock_disk_string_size_get(stock_string_get(stock->currency)),
+    .interval_size = stock_disk_string_size_get(stock_string_get(stock->interval)),
+  };
+
+  size_t values_size = STOCK_VALUE_SIZE * values->count;
+
+  size_t size = sizeof(stock_disk_t) + values_size +
+    header.name_size + header.exchange_size + header.currency_size + header.interval_size;
+
+  char* buffer = malloc(size);
+
+  if (!buffer)
+  {
+    return 3;
+  }
+
+  char* pointer = buffer;
+
+  memcpy(pointer, &header, sizeof(stock_disk_t));
+  pointer += sizeof(stock_disk_t);
+
+  memcpy(pointer, values->time, sizeof(int64_t) * values->count);
+  pointer += sizeof(int64_t) * values->count;
+
+  memcpy(pointer, values->volume, sizeof(int64_t) * values->count);
+  pointer += sizeof(int64_t) * values->count;
+
+  memcpy(pointer, values->high, sizeof(double) * values->count);
+  pointer += sizeof(double) * values->count;
+
+  memcpy(pointer, values->low, sizeof(double) * values->count);
+  pointer += sizeof(double) * values->count;
+
+  memcpy(pointer, values->close, sizeof(double) * values->count);
+  pointer += sizeof(double) * values->count;
+
+  memcpy(pointer, values->open, sizeof(double) * values->count);
+  pointer += sizeof(double) * values->count;
+
+  pointer = stock_disk_string_copy(pointer, stock_string_get(stock->name),     header.name_size);
+  pointer = stock_disk_string_copy(pointer, stock_string_get(stock->exchange), header.exchange_size);
+  pointer = stock_disk_string_copy(pointer, stock_string_get(stock->currency), header.currency_size);
+
+  stock_disk_string_copy(pointer, stock_string_get(stock->interval), header.interval_size);
+
+  size_t write_size = is_durable ?
+    dir_file_write_atomic(buffer, size, stock_disk_dir, name) :
+    dir_file_write_replace(buffer, size, stock_disk_dir, name);
+
+  free(buffer);
+
+  return (write_size == size) ? 0 : 4;
+}
+
+/*
+ * Write stock to the disk cache, if it has changed since it was written
+ *
+ * Fetched data is only marked as dirty, and written in batches by
+ * stock_disk_flush, so that a poll does not wait for the disk
+ */
+static inline void stock_disk_sync(stock_t* stock, bool is_durable)
+{
+  if (!stock->is_dirty) return;
+
+  stock_disk_write(stock, is_durable);
+
+  // A failed write is not retried, the range is written when it changes
+  stock->is_dirty = false;
+}
+
+/*
+ * Get id of string of size bytes, or 0 if it is empty
+ */
+static inline stock_id_t stock_disk_string_id_get(const char* string, int size)
+{
+  return (size > 0) ? stock_string_size_id_get(string, size) : 0;
+}
+
+/*
+ * Get id of interval of size bytes, or 0 if it is not an interval of yahoo
+ */
+static inline stock_id_t stock_disk_interval_id_get(const char* string, int size)
+{
+  for (size_t index = 0; index < STOCK_INTERVAL_COUNT; index++)
+  {
+    if (strlen(STOCK_INTERVALS[index]) == size && memcmp(STOCK_INTERVALS[index], string, size) == 0)
+    {
+      return stock_string_id_get(STOCK_INTERVALS[index]);
+    }
+  }
+
+  return 0;
+}
+
+/*
+ * Read range of symbol from the disk cache into copy, with the interval
+ * it was written with
+ *
+ * The file is mapped to memory and the values are copied from it
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | No disk cache, or bad file name
+ * - 2 | Range is not on disk
+ * - 3 | Bad file
+ * - 4 | Failed to allocate memory
+ */
+static inline int stock_disk_read(stock_t* copy, stock_id_t symbol, stock_id_t range)
+{
+  char name[STOCK_DISK_NAME_SIZE];
+
+  if (!stock_disk_dir[0] || stock_disk_name_get(name, stock_string_get(symbol), stock_string_get(range)) != 0)
+  {
+    return 1;
+  }
+
+  size_t size = 0;
+
+  char* file = dir_file_map(&size, stock_disk_dir, name);
+
+  if (!file)
+  {
+    return 2;
+  }
+
+  if (size < sizeof(stock_disk_t))
+  {
+    error_print("Bad disk cache file: %s", name);
+
+    file_unmap(file, size);
+
+    return 3;
+  }
+
+  stock_disk_t header;
+
+  memcpy(&header, file, sizeof(stock_disk_t));
+
+  size_t count = header.value_count;
+
+  // The count is checked against the file size before it is multiplied,
+  // so a corrupt count can not overflow the size of the values
+  if (header.magic      != STOCK_DISK_MAGIC ||
+      header.value_size != STOCK_VALUE_SIZE ||
+      count == 0 ||
+      count > (size - sizeof(stock_disk_t)) / STOCK_VALUE_SIZE ||
+      header.name_size < 0 || header.exchange_size < 0 || header.currency_size < 0 ||
+      header.interval_size < 0 ||
+      size - sizeof(stock_disk_t) - STOCK_VALUE_SIZE * count !=
+      (size_t) header.name_size + (size_t) header.exchange_size + (size_t) header.currency_size + (size_t) header.interval_size)
+  {
+    error_print("Bad disk cache file: %s", name);
+
+    file_unmap(file, size);
+
+    return 3;
+  }
+
+  // The interval is the last string of the file
+  stock_id_t interval = stock_disk_interval_id_get(file + size - header.interval_size, header.interval_size);
+
+  if (!interval)
+  {
+    error_print("Bad disk cache file: %s", name);
+
+    file_unmap(file, size);
+
+    return 3;
+  }
+
+  stock_values_t values = { 0 };
+
+  if (stock_values_reserve(&values, count) != 0)
+  {
+    file_unmap(file, size);
+
+    return 4;
+  }
+
+  const char* pointer = file + sizeof(stock_disk_t);
+
+  memcpy(values.time, pointer, sizeof(int64_t) * count);
+  pointer += sizeof(int64_t) * count;
+
+  memcpy(values.volume, pointer, sizeof(int64_t) * count);
+  pointer += sizeof(int64_t) * count;
+
+  memcpy(values.high, pointer, sizeof(double) * count);
+  pointer += sizeof(double) * count;
+
+  memcpy(values.low, pointer, sizeof(double) * count);
+  pointer += sizeof(double) * count;
+
+  memcpy(values.close, pointer, sizeof(double) * count);
+  pointer += sizeof(double) * count;
+
+  memcpy(values.open, pointer, sizeof(double) * count);
+  pointer += sizeof(double) * count;
+
+  values.count = count;
+
+  *copy = (stock_t)
+  {
+    .symbol      = symbol,
+    .range       = range,
+    .interval    = interval,
+    .name        = stock_disk_string_id_get(pointer, header.name_size),
+    .exchange    = stock_disk_string_id_get(pointer + header.name_size, header.exchange_size),
+    .currency    = stock_disk_string_id_get(pointer + header.name_size + header.exchange_size, header.currency_size),
+    .volume      = header.volume,
+    .start       = header.start,
+    .end         = header.end,
+    .open        = header.open,
+    .close       = header.close,
+    .high        = header.high,
+    .low         = header.low,
+    .market      = header.market,
+    .values      = values,
+    .fetch_time  = header.fetch_time,
+  };
+
+  file_unmap(file, size);
+
+  return 0;
+}
+
+/*
+ * Cached range of a symbol
+ *
+ * access - when the entry was last used, for evicting the least recently used
+ */
+typedef struct stock_cache_entry_t
+{
+  stock_t       copy;
+  unsigned long access;
+} stock_cache_entry_t;
+
+#define STOCK_CACHE_SIZE (16 * 1024 * 1024)
+
+#define STOCK_CACHE_TTL_MIN 60
+
+#define STOCK_CACHE_TTL_MAX (6 * 60 * 60)
+
+/*
+ * Cache of fetched ranges, keyed by symbol and range
+ *
+ * A range is cached at the interval it was last fetched with. A range
+ * that was refined to a finer interval replaces the coarser one, so
+ * zooming back to it finds the finer values
+ *
+ * Fetched ranges are marked as dirty and written to the disk cache in
+ * batches by stock_disk_flush, or when they are evicted. The disk cache
+ * is the second level of the cache, read when a range is not in memory
+ *
+ * size  - bytes of cached values
+ * limit - max bytes of cached values
+ */
+typedef struct stock_cache_t
+{
+  stock_cache_entry_t* entries;
+  size_t               count;
+  size_t               size;
+  size_t               limit;
+  unsigned long        access;
+} stock_cache_t;
+
+static stock_cache_t stock_cache = { .limit = STOCK_CACHE_SIZE };
+
+/*
+ * Get number of bytes of the values of stock
+ */
+static inline size_t stock_data_size_get(const stock_t* stock)
+{
+  return (stock->values.capacity + stock->_values.capacity) * STOCK_VALUE_SIZE +
+    stock->_pyramid.node_count * sizeof(double) * 2 +
+    (stock->_indicators.capacity + stock->_lines.capacity) * sizeof(double) * STOCK_LINES_COLUMNS;
+}
+
+/*
+ * Check if the data of stock was fetched recently enough to be shown
+ * without fetching it again
+ *
+ * Shorter intervals go stale faster, 1m candles after a minute and
+ * 1d candles after hours
+ */
+static inline bool stock_data_is_fresh(const stock_t* stock)
+{
+  if (stock->fetch_time == 0 || !stock->interval)
+  {
+    return false;
+  }
+
+  int64_t seconds = stock_interval_seconds_get(stock_string_get(stock->interval));
+
+  int64_t ttl = MIN(MAX(seconds, STOCK_CACHE_TTL_MIN), STOCK_CACHE_TTL_MAX);
+
+  return (time(NULL) - stock->fetch_time) < ttl;
+}
+
+/*
+ * Get index of cached range of symbol
+ *
+ * Every lookup is a use of the range, so a found range is marked as the
+ * most recently used, and it is evicted after the ranges not looked up
+ *
+ * RETURN (ssize_t index)
+ * - -1 | Range is not cached
+ */
+static inline ssize_t stock_cache_index_get(stock_id_t symbol, stock_id_t range)
+{
+  for (size_t index = 0; index < stock_cache.count; index++)
+  {
+    stock_t* copy = &stock_cache.entries[index].copy;
+
+    if (copy->symbol == symbol &&
+        copy->range  == range)
+    {
+      stock_cache.entries[index].access = ++stock_cache.access;
+
+      return index;
+    }
+  }
+
+  return -1;
+}
+
+/*
+ * Remove cached range at index, freeing its data if is_free is true
+ */
+static inline void stock_cache_remove(size_t index, bool is_free)
+{
+  stock_t* copy = &stock_cache.entries[index].copy;
+
+  stock_cache.size -= stock_data_size_get(copy);
+
+  if (is_free)
+  {
+    stock_data_free(copy);
+  }
+
+  stock_cache.entries[index] = stock_cache.entries[--stock_cache.count];
+}
+
+/*
+ * Evict the least recently used ranges until size more bytes fit
+ */
+static inline void stock_cache_evict(size_t size)
+{
+  while (stock_cache.count > 0 && stock_cache.size + size > stock_cache.limit)
+  {
+    size_t oldest = 0;
+
+    for (size_t index = 1; index < stock_cache.count; index++)
+    {
+      if (stock_cache.entries[index].access < stock_cache.entries[oldest].access)
+      {
+        oldest = index;
+      }
+    }
+
+    stock_disk_sync(&stock_cache.entries[oldest].copy, false);
+
+    stock_cache_remove(oldest, true);
+  }
+}
+
+/*
+ * Store the data of copy in the cache, taking ownership of the data
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | No values, or larger than the cache
+ * - 2 | Failed to realloc entries
+ */
+static inline int stock_cache_store(stock_t* copy)
+{
+  size_t size = stock_data_size_get(copy);
+
+  if (copy->values.count == 0 || size > stock_cache.limit)
+  {
+    return 1;
+  }
+
+  ssize_t index = stock_cache_index_get(copy->symbol, copy->range);
+
+  if (index != -1)
+  {
+    // Keep the cached range if it is newer
+    if (stock_cache.entries[index].copy.fetch_time > copy->fetch_time)
+    {
+      return 1;
+    }
+
+    stock_cache_remove(index, true);
+  }
+
+  stock_cache_evict(size);
+
+  stock_cache_entry_t* entries = realloc(stock_cache.entries, sizeof(stock_cache_entry_t) * (stock_cache.count + 1));
+
+  if (!entries)
+  {
+    return 2;
+  }
+
+  stock_cache.entries = entries;
+
+  stock_cache.entries[stock_cache.count++] = (stock_cache_entry_t)
+  {
+    .copy   = *copy,
+    .access = ++stock_cache.access,
+  };
+
+  stock_cache.size += size;
+
+  return 0;
+}
+
+/*
+ * Check if range of symbol is cached and fresh
+ */
+static inline bool stock_cache_is_fresh(stock_id_t symbol, stock_id_t range)
+{
+  ssize_t index = stock_cache_index_get(symbol, range);
+
+  return (index != -1) && stock_data_is_fresh(&stock_cache.entries[index].copy);
+}
+
+/*
+ * Set max number of bytes of cached values, evicting what does not fit
+ */
+void stock_cache_size_set(size_t size)
+{
+  stock_cache.limit = size;
+
+  stock_cache_evict(0);
+}
+
+/*
+ * Free all cached ranges
+ *
+ * The dirty ranges are written to disk by stock_quit before this
+ */
+static inline void stock_cache_free(void)
+{
+  for (size_t index = 0; index < stock_cache.count; index++)
+  {
+    stock_data_free(&stock_cache.entries[index].copy);
+  }
+
+  free(stock_cache.entries);
+
+  stock_cache = (stock_cache_t) { .limit = stock_cache.limit };
+}
+
+/*
+ * Replace the data of stock with the data of copy, like stock_data_swap,
+ * but cache the old range, so zooming back to it is instant
+ */
+static inline void stock_data_stash(stock_t* stock, stock_t* copy)
+{
+  stock_t old = *stock;
+
+  copy->version = stock->version + 1;
+
+  *stock = *copy;
+
+  if (stock_cache_store(&old) != 0)
+  {
+    stock_disk_sync(&old, false);
+
+    stock_data_free(&old);
+  }
+}
+
+/*
+ * Zoom stock to a range in the cache or the disk cache, without fetching
+ *
+ * The range comes at the interval it was cached with, which might be
+ * finer than the interval picked for the range, if it was refined
+ *
+ * The 1d meta data of the stock is kept, because it is newer
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Success, but the values are stale and should be updated
+ * - 2 | Range is not cached
+ */
+static inline int stock_cache_zoom(stock_t* stock, stock_id_t range)
+{
+  if (stock_range_index_get(stock_string_get(range)) == -1)
+  {
+    return 2;
+  }
+
+  ssize_t index = stock_cache_index_get(stock->symbol, range);
+
+  stock_t copy;
+
+  if (index != -1)
+  {
+    copy = stock_cache.entries[index].copy;
+
+    stock_cache_remove(index, false);
+  }
+  else if (stock_disk_read(&copy, stock->symbol, range) != 0)
+  {
+    return 2;
+  }
+
+  if (!stock_range_is_day(copy.range) && stock->values.count > 0)
+  {
+    stock_day_copy(&copy, stock);
+
+    copy.volume = stock->volume;
+
+    copy.market = stock->market;
+  }
+
+  stock_data_stash(stock, &copy);
+
+  return stock_data_is_fresh(stock) ? 0 : 1;
+}
+
+/*
+ * Live stock of a symbol, shared by everything that shows the symbol
+ *
+ * ref_count - stock_create calls that returned the stock, that have
+ *             not been freed with stock_free
+ */
+typedef struct stock_index_entry_t
+{
+  stock_t* stock;
+  int      ref_count;
+} stock_index_entry_t;
+
+/*
+ * Live stocks, indexed by the id of their symbol
+ *
+ * The ids are small and dense, so the id is used as a perfect hash
+ * of the symbol. The references are counted here instead of in the
+ * stock, because the data of a stock is replaced by swapping
+ */
+typedef struct stock_index_t
+{
+  stock_index_entry_t* entries;
+  size_t               capacity;
+} stock_index_t;
+
+static stock_index_t stock_index = { 0 };
+
+/*
+ * Get entry of symbol in the index
+ *
+ * RETURN (stock_index_entry_t* entry)
+ * - NULL | No live stock of symbol
+ */
+static inline stock_index_entry_t* stock_index_entry_get(stock_id_t symbol)
+{
+  if (symbol > 0 && symbol < stock_index.capacity && stock_index.entries[symbol].stock)
+  {
+    return &stock_index.entries[symbol];
+  }
+
+  return NULL;
+}
+
+/*
+ * Take a reference to the live stock of symbol
+ *
+ * RETURN (stock_t* stock)
+ * - NULL | No live stock of symbol
+ */
+static inline stock_t* stock_index_take(stock_id_t symbol)
+{
+  stock_index_entry_t* entry = stock_index_entry_get(symbol);
+
+  if (!entry)
+  {
+    return NULL;
+  }
+
+  entry->ref_count++;
+
+  return entry->stock;
+}
+
+/*
+ * Make stock the live stock of its symbol
+ *
+ * If another stock of the symbol is already live, stock is freed and
+ * a reference to the live stock is returned instead
+ *
+ * RETURN (stock_t* stock)
+ * - The live stock of the symbol, stock if the index could not grow
+ */
+static inline stock_t* stock_index_share(stock_t* stock)
+{
+  stock_index_entry_t* entry = stock_index_entry_get(stock->symbol);
+
+  if (entry && entry->stock == stock)
+  {
+    return stock;
+  }
+
+  if (entry)
+  {
+    stock_free(&stock);
+
+    entry->ref_count++;
+
+    return entry->stock;
+  }
+
+  if (stock->symbol >= stock_index.capacity)
+  {
+    size_t capacity = MAX(stock_index.capacity * 2, stock->symbol + 1);
+
+    stock_index_entry_t* entries = realloc(stock_index.entries, sizeof(stock_index_entry_t) * capacity);
+
+    if (!entries)
+    {
+      return stock;
+    }
+
+    memset(entries + stock_index.capacity, 0, sizeof(stock_index_entry_t) * (capacity - stock_index.capacity));
+
+    stock_index.entries  = entries;
+    stock_index.capacity = capacity;
+  }
+
+  stock_index.entries[stock->symbol] = (stock_index_entry_t)
+  {
+    .stock     = stock,
+    .ref_count = 1,
+  };
+
+  return stock;
+}
+
+/*
+ * Free the index, the live stocks are freed by their owners
+ */
+static inline void stock_index_free(void)
+{
+  free(stock_index.entries);
+
+  stock_index = (stock_index_t) { 0 };
+}
+
+/*
+ * Write at most limit dirty stocks to the disk cache, the live stocks
+ * before the cached ranges, or every dirty stock if limit is 0
+ *
+ * RETURN (size_t write_count)
+ */
+static inline size_t stock_disk_flush(size_t limit, bool is_durable)
+{
+  size_t write_count = 0;
+
+  for (size_t index = 0; index < stock_index.capacity; index++)
+  {
+    stock_t* stock = stock_index.entries[index].stock;
+
+    if (limit > 0 && write_count >= limit) return write_count;
+
+    if (!stock || !stock->is_dirty) continue;
+
+    stock_disk_sync(stock, is_durable);
+
+    write_count++;
+  }
+
+  for (size_t index = 0; index < stock_cache.count; index++)
+  {
+    stock_t* copy = &stock_cache.entries[index].copy;
+
+    if (limit > 0 && write_count >= limit) return write_count;
+
+    if (!copy->is_dirty) continue;
+
+    stock_disk_sync(copy, is_durable);
+
+    write_count++;
+  }
+
+  return write_count;
+}
+
+static inline void stock_async_remove(stock_t* stock);
+
+static inline void stock_zoom_cancel(stock_t* stock);
+
+/*
+ * Free stock object, caching its data in memory
+ *
+ * A shared stock is only freed when its last reference is freed
+ */
+void stock_free(stock_t** stock)
+{
+  if (!stock || !(*stock)) return;
+
+  stock_index_entry_t* entry = stock_index_entry_get((*stock)->symbol);
+
+  if (entry && entry->stock == *stock)
+  {
+    if (--entry->ref_count > 0)
+    {
+      *stock = NULL;
+
+      return;
+    }
+
+    *entry = (stock_index_entry_t) { 0 };
+  }
+
+  stock_async_remove(*stock);
+
+  if (stock_cache_store(*stock) != 0)
+  {
+    stock_disk_sync(*stock, false);
+
+    stock_data_free(*stock);
+  }
+
+  free(*stock);
+
+  *stock = NULL;
+}
+
+/*
+ * Zoom existing stock to specified range and update 1d meta data
+ *
+ * The range is taken from the cache if possible
+ *
+ * On error, stock is not affected
+ */
+int stock_zoom(stock_t* stock, char* range)
+{
+  const char* interval = stock_range_interval_get(range);
+
+  if (!interval)
+  {
+    return 1;
+  }
+
+  stock_zoom_cancel(stock);
+
+  stock_t copy = (stock_t)
+  {
+    .symbol   = stock->symbol,
+    .range    = stock_string_id_get(range),
+    .interval = stock_string_id_get(interval),
+  };
+
+  int status = stock_cache_zoom(stock, copy.range);
+
+  if (status == 0)
+  {
+    return 0;
+  }
+
+  // Show the stale values, if the update fails
+  if (status == 1)
+  {
+    stock_update(stock);
+
+    return 0;
+  }
+
+
+  if (stock_update(&copy) != 0)
+  {
+    stock_data_free(&copy);
+
+    return 2;
+  }
+
+  stock_data_stash(stock, &copy);
+
+  return 0;
+}
+
+/*
+ * Get the time to fetch new values from, which is the time of the last
+ * value, because the last candle might still be changing
+ *
+ * The 1d meta data can only be calculated from candles of at most a day,
+ * so longer intervals always fetch the whole range. If it can not be
+ * calculated from the merged candles, the old 1d meta data is kept
+ *
+ * RETURN (int64_t period)
+ * - 0  | Fetch the whole range
+ * - >0 | Fetch the values from period
+ */
+static inline int64_t stock_delta_period_get(const stock_t* stock)
+{
+  const stock_values_t* values = &stock->values;
+
+  if (values->count == 0)
+  {
+    return 0;
+  }
+
+  if (stock_interval_seconds_get(stock_string_get(stock->interval)) > STOCK_DAY_SECONDS)
+  {
+    return 0;
+  }
+
+  return values->time[values->count - 1];
+}
+
+/*
+ * Check if delta has anything that stock does not have
+ *
+ * Delta starts at the last value of stock, so only the last values
+ * and the market data have to be compared
+ */
+static inline bool stock_delta_is_new(const stock_t* stock, const stock_t* delta)
+{
+  if (delta->values.count == 0 || stock->values.count == 0)
+  {
+    return false;
+  }
+
+  stock_value_t last  = stock_value_get(&stock->values, stock->values.count - 1);
+  stock_value_t value = stock_value_get(&delta->values, delta->values.count - 1);
+
+  return memcmp(&last, &value, sizeof(stock_value_t)) != 0 ||
+    stock->volume       != delta->volume       ||
+    stock->market.price != delta->market.price ||
+    stock->market.high  != delta->market.high  ||
+    stock->market.low   != delta->market.low;
+}
+
+/*
+ * Append the values of delta to stock, replacing the values of stock
+ * from the first value of delta, and dropping the values that fell out
+ * of the range
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | No values in delta
+ * - 2 | Failed to allocate values
+ */
+static inline int stock_values_append(stock_t* stock, const stock_t* delta)
+{
+  if (delta->values.count == 0)
+  {
+    return 1;
+  }
+
+  stock_values_t* values = &stock->values;
+
+  bool is_view_live = (stock->_view_end == 0 || stock->_view_end >= values->count);
+
+  int64_t first = delta->values.time[0];
+
+  size_t keep_count = values->count;
+
+  while (keep_count > 0 && values->time[keep_count - 1] >= first)
+  {
+    keep_count--;
+  }
+
+  size_t count = keep_count + delta->values.count;
+
+  if (stock_values_reserve(values, count) != 0)
+  {
+    return 2;
+  }
+
+  stock->_resize_stable = MIN(stock->_resize_stable, keep_count);
+
+  // The indicators of the replaced values are calculated again
+  stock->_indicators.count = MIN(stock->_indicators.count, keep_count);
+
+  stock_values_move(values, keep_count, &delta->values, 0, delta->values.count);
+
+  int64_t last = values->time[count - 1];
+
+  int64_t start = 0;
+
+  // The 1d range is the current trading session, the others are a duration
+  if (stock_range_is_day(stock->range))
+  {
+    start = delta->market.start;
+  }
+  else
+  {
+    int64_t seconds = stock_interval_seconds_get(stock_string_get(stock->range));
+
+    start = (seconds > 0) ? (last - seconds) : 0;
+  }
+
+  size_t drop_count = 0;
+
+  if (start <= last)
+  {
+    while (values->time[drop_count] < start)
+    {
+      drop_count++;
+    }
+  }
+
+  if (drop_count > 0)
+  {
+    stock_values_move(values, 0, values, drop_count, count - drop_count);
+
+    stock->_resize_stable = 0;
+
+    stock_lines_drop(&stock->_indicators, drop_count);
+  }
+
+  values->count = count - drop_count;
+
+  stock_pyramid_append(&stock->_pyramid, values, keep_count, drop_count);
+
+  // Keep the view on the same values, or reset it if they were dropped
+  if (stock->_view_end > 0 && stock->_view_end <= drop_count)
+  {
+    stock_view_reset(stock);
+  }
+  else
+  {
+    stock->_view_first -= MIN(stock->_view_first, drop_count);
+
+    // A view that ended at the last value follows the new values
+    stock->_view_end = is_view_live ? 0 : stock->_view_end - drop_count;
+  }
+
+  return 0;
+}
+
+/*
+ * Merge delta into stock, updating the values and meta data
+ *
+ * If the 1d meta data can not be calculated, like outside of trading
+ * hours when there are no candles of the current session, the old meta
+ * data is kept. The merged values are still new, so it is not an error
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to append values
+ */
+static inline int stock_delta_merge(stock_t* stock, const stock_t* delta)
+{
+  if (stock_values_append(stock, delta) != 0)
+  {
+    return 1;
+  }
+
+  stock->volume = delta->volume;
+
+  stock->market = delta->market;
+
+  stock->fetch_time = delta->fetch_time;
+
+  // The chart resizes the values again when it sees the new version
+  stock->version++;
+
+  // Both calculations leave the meta data alone when they fail
+  if (stock_range_is_day(stock->range))
+  {
+    stock_meta_calc(stock);
+  }
+  else stock_market_calc(stock);
+
+  return 0;
+}
+
+/*
+ * Update stock by only fetching the values after the last known value
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | The whole range has to be fetched
+ * - 2 | Failed to fetch delta
+ * - 3 | Failed to merge delta
+ */
+static inline int stock_delta_update(stock_t* stock)
+{
+  int64_t period = stock_delta_period_get(stock);
+
+  if (period == 0)
+  {
+    return 1;
+  }
+
+  stock_t delta = (stock_t)
+  {
+    .symbol   = stock->symbol,
+    .range    = stock->range,
+    .interval = stock->interval,
+  };
+
+  stock_response_t* response = stock_response_get(stock_string_get(delta.symbol), stock_string_get(delta.range), stock_string_get(delta.interval), period);
+
+  if (!response || stock_response_parse(&delta, response) != 0)
+  {
+    stock_data_free(&delta);
+
+    return 2;
+  }
+
+  int status = stock_delta_merge(stock, &delta);
+
+  stock_data_free(&delta);
+
+  if (status != 0)
+  {
+    return 3;
+  }
+
+  stock->is_dirty = true;
+
+  return 0;
+}
+
+/*
+ * Update stock by fetching specified range and 1d meta data
+ *
+ * The 1d meta data is calculated from the range values when possible,
+ * so most updates only need one request. When the candles are longer
+ * than a day, the 1d data is fetched in parallel with the range
+ *
+ * If stock already has values of at most a day, only the new values are
+ * fetched
+ *
+ * The values are fetched even if they are fresh, because an update is
+ * asked for explicitly. Callers that can show fresh data as it is, check
+ * for that first, like stock_zoom and stock_create through the cache
+ */
+int stock_update(stock_t* stock)
+{
+  // Only fetch the new values, if the candles are at most a day long
+  if (stock_delta_update(stock) == 0)
+  {
+    return 0;
+  }
+
+  const char* interval = stock_range_interval_get("1d");
+
+  if (!interval)
+  {
+    return 1;
+  }
+
+  stock_t copy = (stock_t)
+  {
+    .symbol   = stock->symbol,
+    .range    = stock->range,
+    .interval = stock->interval,
+  };
+
+  stock_t day = (stock_t)
+  {
+    .symbol   = stock->symbol,
+    .range    = stock_string_id_get("1d"),
+    .interval = stock_string_id_get(interval),
+  };
+
+  int status = 0;
+
+  // 1. The values of the 1d range are the 1d meta data
+  if (stock_range_is_day(stock->range))
+  {
+    if (stock_fetch(&copy) != 0 || stock_meta_calc(&copy) != 0)
+    {
+      status = 2;
+    }
+  }
+  // 2. The 1d meta data can not be calculated, fetch it in parallel
+  else if (stock_interval_seconds_get(stock_string_get(stock->interval)) > STOCK_DAY_SECONDS)
+  {
+    stock_t* stocks[] = { &copy, &day };
+
+    int statuses[2];
+
+    if (stock_fetch_many(stocks, statuses, 2, 2) != 2 || stock_meta_calc(&day) != 0)
+    {
+      status = 3;
+    }
+    else stock_day_copy(&copy, &day);
+  }
+  // 3. Calculate the 1d meta data, and only fetch it if that fails
+  else if (stock_fetch(&copy) != 0)
+  {
+    status = 4;
+  }
+  else if (stock_market_calc(&copy) != 0)
+  {
+    if (stock_fetch(&day) != 0 || stock_meta_calc(&day) != 0)
+    {
+      status = 5;
+    }
+    else stock_day_copy(&copy, &day);
+  }
+
+  stock_data_free(&day);
+
+  if (status != 0)
+  {
+    stock_data_free(&copy);
+
+    return status;
+  }
+
+  stock_data_swap(stock, &copy);
+
+  stock->is_dirty = true;
+
+  return 0;
+}
+
+/*
+ * Create stock without fetching, with symbol and 1d range
+ */
+static inline stock_t* stock_empty_create(char* symbol)
+{
+  char* range = "1d";
+
+  const char* interval = stock_range_interval_get(range);
+
+  if (!interval)
+  {
+    return NULL;
+  }
+
+  stock_t* stock = malloc(sizeof(stock_t));
+
+  if (!stock)
+  {
+    return NULL;
+  }
+
+  *stock = (stock_t)
+  {
+    .symbol   = stock_string_id_get(symbol),
+    .range    = stock_string_id_get(range),
+    .interval = stock_string_id_get(interval),
+  };
+
+  return stock;
+}
+
+/*
+ * Create stock with symbol and 1d range data, from the cache if possible
+ *
+ * If the symbol is already live, the live stock is shared instead, with
+ * whatever range it has. Free every created stock with stock_free
+ *
+ * This blocks while the stock is fetched, the UI uses stock_create_start
+ */
+stock_t* stock_create(char* symbol)
+{
+  stock_t* stock = stock_index_take(stock_string_id_get(symbol));
+
+  if (stock)
+  {
+    return stock;
+  }
+
+  stock = stock_empty_create(symbol);
+
+  if (!stock)
+  {
+    return NULL;
+  }
+
+  int status = stock_cache_zoom(stock, stock->range);
+
+  // Show the stale values, if the update fails
+  if (status == 1)
+  {
+    stock_update(stock);
+  }
+
+  if (status != 2)
+  {
+    return stock_index_share(stock);
+  }
+
+  if (stock_fetch(stock) != 0)
+  {
+    stock_free(&stock);
+
+    return NULL;
+  }
+
+  if (stock_meta_calc(stock) != 0)
+  {
+    stock_free(&stock);
+
+    return NULL;
+  }
+
+  stock->is_dirty = true;
+
+  return stock_index_share(stock);
+}
+
+/*
+ * Create many stocks with 1d range data, fetching them concurrently
+ *
+ * At most limit requests are in flight at once (0 means STOCK_MULTI_LIMIT)
+ *
+ * Stocks in the cache or the disk cache are not fetched, even if they are
+ * stale, so that they can be shown right away and be polled afterwards
+ *
+ * Live stocks and repeated symbols are shared, like with stock_create
+ *
+ * stocks[index] is the stock of symbols[index], or NULL if it failed
+ *
+ * RETURN (size_t created_count)
+ */
+size_t stock_create_many(stock_t** stocks, char** symbols, size_t count, size_t limit)
+{
+  int* statuses = malloc(sizeof(int) * count);
+
+  stock_t** fetches = malloc(sizeof(stock_t*) * count);
+
+  if (!statuses || !fetches)
+  {
+    free(statuses);
+
+    free(fetches);
+
+    memset(stocks, 0, sizeof(stock_t*) * count);
+
+    return 0;
+  }
+
+  for (size_t index = 0; index < count; index++)
+  {
+    stocks[index] = stock_index_take(stock_string_id_get(symbols[index]));
+
+    if (stocks[index])
+    {
+      fetches[index] = NULL;
+
+      continue;
+    }
+
+    stocks[index] = stock_empty_create(symbols[index]);
+
+    fetches[index] = stocks[index];
+
+    if (stocks[index] && stock_cache_zoom(stocks[index], stocks[index]->range) != 2)
+    {
+      fetches[index] = NULL;
+    }
+  }
+
+  stock_fetch_many(fetches, statuses, count, limit);
+
+  size_t created_count = 0;
+
+  for (size_t index = 0; index < count; index++)
+  {
+    if ((stocks[index] && !fetches[index]) ||
+        (statuses[index] == 0 && stock_meta_calc(stocks[index]) == 0))
+    {
+      if (fetches[index])
+      {
+        stocks[index]->is_dirty = true;
+      }
+
+      stocks[index] = stock_index_share(stocks[index]);
+
+      created_count++;
+    }
+    else
+    {
+      stock_free(&stocks[index]);
+    }
+  }
+
+  free(fetches);
+
+  free(statuses);
+
+  return created_count;
+}
+
+/*
+ * Types of asynchronous jobs
+ *
+ * POLL     - periodic refresh of a stock
+ * ZOOM     - change of range, that supersedes the previous zoom of the stock
+ * PREFETCH - range that the focused stock will probably be zoomed to
+ */
+typedef enum stock_job_type_t
+{
+  STOCK_JOB_POLL,
+  STOCK_JOB_ZOOM,
+  STOCK_JOB_PREFETCH,
+} stock_job_type_t;
+
+/*
+ * Asynchronous job, fetching new data for a stock without blocking
+ *
+ * copy    - new data, swapped into stock when the job is done
+ * period  - time of the first fetched value, or 0 for the whole range
+ * version - version of stock when the job started, to discard stale data
+ * due     - time when a replayed job is added to the multi handle
+ */
+typedef struct stock_job_t
+{
+  CURL*            easy;
+  stock_response_t response;
+  char*            url;
+  stock_job_type_t type;
+  stock_t*         stock;
+  stock_t          copy;
+  int64_t          period;
+  unsigned long    version;
+  long             due;
+  bool             is_active;
+} stock_job_t;
+
+/*
+ * Polled stock, refreshed when time has passed
+ */
+typedef struct stock_poll_t
+{
+  stock_t* stock;
+  time_t   time;
+} stock_poll_t;
+
+#define STOCK_ASYNC_LIMIT 8
+
+#define STOCK_POLL_DELAY 60
+
+#define STOCK_PREFETCH_LIMIT 2
+
+#define STOCK_DISK_DELAY 10
+
+#define STOCK_DISK_FLUSH_LIMIT 1
+
+/*
+ * Asynchronous engine, running jobs on its own multi handle
+ *
+ * The jobs only progress when stock_async_run is called from the main
+ * loop, so new data is swapped in between frames and never while a
+ * window is reading it
+ */
+typedef struct stock_async_t
+{
+  CURLM*            multi;
+  stock_job_t       jobs[STOCK_ASYNC_LIMIT];
+  stock_poll_t*     polls;
+  size_t            poll_count;
+  int               delay;
+  stock_t*          prefetch_stock; // Focused stock
+  int               prefetch_mask;  // Ranges that have been prefetched
+  time_t            flush_time;     // When dirty stocks are written to disk
+} stock_async_t;
+
+static stock_async_t stock_async = { .delay = STOCK_POLL_DELAY };
+
+/*
+ * Initialize asynchronous engine, only the first call does anything
+ */
+static inline int stock_async_init(void)
+{
+  if (stock_async.multi)
+  {
+    return 0;
+  }
+
+  if (stock_init() != 0)
+  {
+    return 1;
+  }
+
+  stock_async.multi = curl_multi_init();
+
+  if (!stock_async.multi)
+  {
+    return 2;
+  }
+
+  curl_multi_setopt(stock_async.multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+
+  return 0;
+}
+
+/*
+ * Stop job, freeing the data that was not swapped into the stock
+ */
+static inline void stock_job_stop(stock_job_t* job)
+{
+  if (!job->is_active) return;
+
+  curl_multi_remove_handle(stock_async.multi, job->easy);
+
+  stock_record_stop(&job->response, false);
+
+  free(job->url);
+
+  stock_data_free(&job->copy);
+
+  job->url       = NULL;
+  job->stock     = NULL;
+  job->copy      = (stock_t) { 0 };
+  job->is_active = false;
+}
+
+/*
+ * Start job fetching range and interval of stock
+ *
+ * RETURN (stock_job_t* job)
+ * - NULL | No idle job, or failed to start job
+ */
+static inline stock_job_t* stock_job_start(stock_t* stock, stock_id_t range, stock_id_t interval, int64_t period, stock_job_type_t type)
+{
+  if (stock_async_init() != 0)
+  {
+    return NULL;
+  }
+
+  stock_job_t* job = NULL;
+
+  for (size_t index = 0; index < STOCK_ASYNC_LIMIT; index++)
+  {
+    if (!stock_async.jobs[index].is_active)
+    {
+      job = &stock_async.jobs[index];
+
+      break;
+    }
+  }
+
+  if (!job)
+  {
+    return NULL;
+  }
+
+  if (!job->easy && !(job->easy = curl_easy_duphandle(stock_curl.easy)))
+  {
+    return NULL;
+  }
+
+  job->copy = (stock_t)
+  {
+    .symbol   = stock->symbol,
+    .range    = range,
+    .interval = interval,
+  };
+
+  job->url = stock_url_create(stock_string_get(job->copy.symbol), stock_string_get(job->copy.range), stock_string_get(job->copy.interval), period);
+
+  job->response.is_json = false;
+
+  if (!job->url || stock_response_clear(&job->response) != 0)
+  {
+    free(job->url);
+
+    stock_data_free(&job->copy);
+
+    return NULL;
+  }
+
+  curl_easy_setopt(job->easy, CURLOPT_URL, job->url);
+
+  curl_easy_setopt(job->easy, CURLOPT_WRITEDATA, &job->response);
+
+  curl_easy_setopt(job->easy, CURLOPT_PRIVATE, job);
+
+  stock_record_start(&job->response, stock_string_get(job->copy.symbol), stock_string_get(job->copy.range), stock_string_get(job->copy.interval), period);
+
+  job->due = stock_replay_due_get();
+
+  if (job->due == 0 && curl_multi_add_handle(stock_async.multi, job->easy) != CURLM_OK)
+  {
+    stock_record_stop(&job->response, false);
+
+    free(job->url);
+
+    stock_data_free(&job->copy);
+
+    return NULL;
+  }
+
+  job->type      = type;
+  job->period    = period;
+  job->stock     = stock;
+  job->version   = stock->version;
+  job->is_active = true;
+
+  return job;
+}
+
+/*
+ * Get active job of type for stock, or for any stock if stock is NULL
+ */
+static inline stock_job_t* stock_job_get(stock_t* stock, stock_job_type_t type)
+{
+  for (size_t index = 0; index < STOCK_ASYNC_LIMIT; index++)
+  {
+    stock_job_t* job = &stock_async.jobs[index];
+
+    if (job->is_active && (!stock || job->stock == stock) && job->type == type)
+    {
+      return job;
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Check if two stocks have the same data, comparing the meta data and
+ * the first and last values
+ */
+static inline bool stock_data_is_equal(const stock_t* first, const stock_t* second)
+{
+  if (first->values.count != second->values.count ||
+      first->volume      != second->volume      ||
+      first->start       != second->start       ||
+      first->end         != second->end         ||
+      first->open        != second->open        ||
+      first->close       != second->close       ||
+      first->high        != second->high        ||
+      first->low         != second->low)
+  {
+    return false;
+  }
+
+  size_t count = first->values.count;
+
+  if (count == 0)
+  {
+    return true;
+  }
+
+  stock_value_t values[4] =
+  {
+    stock_value_get(&first->values,  0),
+    stock_value_get(&second->values, 0),
+    stock_value_get(&first->values,  count - 1),
+    stock_value_get(&second->values, count - 1),
+  };
+
+  return memcmp(&values[0], &values[1], sizeof(stock_value_t)) == 0 &&
+         memcmp(&values[2], &values[3], sizeof(stock_value_t)) == 0;
+}
+
+/*
+ * Update stock in the background, like stock_update, by starting a poll
+ * right away
+ *
+ * RETURN (int status)
+ * - 0 | Success, or stock is already being updated
+ * - 1 | No idle job, a polled stock is updated when one is idle
+ */
+int stock_update_start(stock_t* stock)
+{
+  if (stock_job_get(stock, STOCK_JOB_POLL))
+  {
+    return 0;
+  }
+
+  int64_t period = stock_delta_period_get(stock);
+
+  if (stock_job_start(stock, stock->range, stock->interval, period, STOCK_JOB_POLL))
+  {
+    return 0;
+  }
+
+  // No idle job, poll as soon as one is idle
+  for (size_t index = 0; index < stock_async.poll_count; index++)
+  {
+    if (stock_async.polls[index].stock == stock)
+    {
+      stock_async.polls[index].time = 0;
+    }
+  }
+
+  return 1;
+}
+
+/*
+ * Get active prefetch job of range of stock
+ */
+static inline stock_job_t* stock_prefetch_job_get(stock_t* stock, stock_id_t range)
+{
+  for (size_t index = 0; index < STOCK_ASYNC_LIMIT; index++)
+  {
+    stock_job_t* job = &stock_async.jobs[index];
+
+    if (job->is_active && job->stock == stock && job->type == STOCK_JOB_PREFETCH &&
+        job->copy.range == range)
+    {
+      return job;
+    }
+  }
+
+  return NULL;
+}
+
+/*
+ * Calculate the 1d meta data of the fetched data of job
+ *
+ * If it can not be calculated from the values, the 1d meta data of the
+ * stock is kept, instead of blocking on a 1d request
+ */
+static inline void stock_job_day_calc(stock_job_t* job)
+{
+  stock_t* copy = &job->copy;
+
+  int status = stock_range_is_day(copy->range) ? stock_meta_calc(copy) : stock_market_calc(copy);
+
+  if (status != 0)
+  {
+    stock_day_copy(copy, job->stock);
+  }
+}
+
+/*
+ * Finish poll job, swapping in or appending the new data if it changed
+ *
+ * RETURN (bool is_changed)
+ */
+static inline bool stock_poll_done(stock_job_t* job)
+{
+  stock_t* stock = job->stock;
+
+  stock_t* copy = &job->copy;
+
+  // Only the new values were fetched, append them
+  if (job->period > 0)
+  {
+    if (!stock_delta_is_new(stock, copy) || stock_delta_merge(stock, copy) != 0)
+    {
+      return false;
+    }
+
+    stock->is_dirty = true;
+
+    return true;
+  }
+
+  stock_job_day_calc(job);
+
+  if (stock_data_is_equal(stock, copy))
+  {
+    return false;
+  }
+
+  stock_data_swap(stock, copy);
+
+  *copy = (stock_t) { 0 };
+
+  stock->is_dirty = true;
+
+  return true;
+}
+
+/*
+ * Finish zoom job, swapping in the new range
+ *
+ * A refined range keeps showing the same time span as before, and
+ * replaces the coarser values instead of caching them
+ */
+static inline void stock_zoom_done(stock_job_t* job)
+{
+  stock_t* stock = job->stock;
+
+  stock_job_day_calc(job);
+
+  job->copy.is_dirty = true;
+
+  if (job->copy.range != stock->range || stock->values.count == 0)
+  {
+    stock_data_stash(stock, &job->copy);
+
+    job->copy = (stock_t) { 0 };
+
+    return;
+  }
+
+  size_t end = stock_view_end_get(stock);
+
+  bool is_live = (end == stock->values.count);
+
+  int64_t start_time = stock->values.time[stock_view_first_get(stock)];
+
+  // The last candle of the view lasts until the end of its interval
+  int64_t end_time = stock->values.time[end - 1] + stock_interval_seconds_get(stock_string_get(stock->interval));
+
+  stock_data_swap(stock, &job->copy);
+
+  job->copy = (stock_t) { 0 };
+
+  size_t first = stock_time_index_get(&stock->values, start_time);
+
+  size_t last  = is_live ? stock->values.count : stock_time_index_get(&stock->values, end_time);
+
+  if (stock_view_set(stock, first, last) == 0 && is_live)
+  {
+    stock->_view_end = 0;
+  }
+}
+
+/*
+ * Finish prefetch job, caching the range until it is zoomed to
+ */
+static inline void stock_prefetch_done(stock_job_t* job)
+{
+  stock_job_day_calc(job);
+
+  job->copy.is_dirty = true;
+
+  if (stock_cache_store(&job->copy) == 0)
+  {
+    job->copy = (stock_t) { 0 };
+  }
+  else stock_disk_sync(&job->copy, false);
+}
+
+/*
+ * Finish job, parsing the response and handling the new data
+ *
+ * RETURN (bool is_changed)
+ */
+static inline bool stock_job_done(stock_job_t* job, CURLcode result)
+{
+  // Restart with json-c if the chart parser did not understand the response
+  if (result == CURLE_WRITE_ERROR && !job->response.is_json)
+  {
+    curl_multi_remove_handle(stock_async.multi, job->easy);
+
+    job->response.is_json = true;
+
+    if (stock_response_clear(&job->response) == 0 &&
+        curl_multi_add_handle(stock_async.multi, job->easy) == CURLM_OK)
+    {
+      return false;
+    }
+  }
+
+  stock_record_stop(&job->response, result == CURLE_OK);
+
+  bool is_changed = false;
+
+  bool is_zoomed = false;
+
+  // The stock was replaced while the poll was running, the data is stale
+  if (job->type == STOCK_JOB_POLL && job->stock->version != job->version)
+  {
+    stock_job_stop(job);
+
+    return false;
+  }
+
+  if (result != CURLE_OK || stock_response_parse(&job->copy, &job->response) != 0)
+  {
+    error_print("Failed to fetch stock: %s", stock_string_get(job->copy.symbol));
+  }
+  else switch (job->type)
+  {
+    case STOCK_JOB_POLL:
+      is_changed = stock_poll_done(job);
+      break;
+
+    case STOCK_JOB_ZOOM:
+      stock_zoom_done(job);
+      is_zoomed = true;
+      break;
+
+    case STOCK_JOB_PREFETCH:
+      stock_prefetch_done(job);
+      break;
+  }
+
+  // The zoom is no longer loading, even if it failed
+  if (job->type == STOCK_JOB_ZOOM)
+  {
+    is_changed = true;
+  }
+
+  stock_t* stock = job->stock;
+
+  stock_job_stop(job);
+
+  // The zoomed range might have fewer values than the chart has columns
+  if (is_zoomed)
+  {
+    stock_refine_start(stock);
+  }
+
+  return is_changed;
+}
+
+/*
+ * Start poll jobs of stocks that are due for a refresh
+ */
+static inline void stock_polls_start(void)
+{
+  time_t now = time(NULL);
+
+  for (size_t index = 0; index < stock_async.poll_count; index++)
+  {
+    stock_poll_t* poll = &stock_async.polls[index];
+
+    if (poll->time > now || stock_job_get(poll->stock, STOCK_JOB_POLL))
+    {
+      continue;
+    }
+
+    stock_t* stock = poll->stock;
+
+    int64_t period = stock_delta_period_get(stock);
+
+    // No idle job, try again next time
+    if (!stock_job_start(stock, stock->range, stock->interval, period, STOCK_JOB_POLL))
+    {
+      break;
+    }
+
+    poll->time = now + stock_async.delay;
+  }
+}
+
+/*
+ * Start prefetch jobs of the ranges of the focused stock
+ *
+ * Prefetching waits until the zoom of the stock has loaded, and only
+ * uses a few of the jobs, so that polls and zooms are not delayed
+ */
+static inline void stock_prefetches_start(void)
+{
+  stock_t* stock = stock_async.prefetch_stock;
+
+  if (!stock || stock_job_get(stock, STOCK_JOB_ZOOM))
+  {
+    return;
+  }
+
+  size_t active_count = 0;
+
+  for (size_t index = 0; index < STOCK_ASYNC_LIMIT; index++)
+  {
+    if (stock_async.jobs[index].is_active && stock_async.jobs[index].type == STOCK_JOB_PREFETCH)
+    {
+      active_count++;
+    }
+  }
+
+  for (size_t index = 0; index < STOCK_RANGE_COUNT && active_count < STOCK_PREFETCH_LIMIT; index++)
+  {
+    stock_id_t range = stock_string_id_get(STOCK_RANGES[index]);
+
+    stock_id_t interval = stock_string_id_get(stock_range_interval_get(STOCK_RANGES[index]));
+
+    if ((stock_async.prefetch_mask & (1 << index)) || stock->range == range ||
+        stock_cache_is_fresh(stock->symbol, range))
+    {
+      continue;
+    }
+
+    if (!stock_job_start(stock, range, interval, 0, STOCK_JOB_PREFETCH))
+    {
+      break;
+    }
+
+    stock_async.prefetch_mask |= (1 << index);
+
+    active_count++;
+  }
+}
+
+/*
+ * Write the dirty stocks to the disk cache, a few at a time
+ *
+ * Once the disk delay has passed, STOCK_DISK_FLUSH_LIMIT stocks are
+ * written every run until none is dirty. The changes of a poll round
+ * are batched, and a run only waits for small writes, that are not
+ * synced to the disk
+ */
+static inline void stock_disk_flush_step(void)
+{
+  time_t now = time(NULL);
+
+  if (now < stock_async.flush_time)
+  {
+    return;
+  }
+
+  if (stock_disk_flush(STOCK_DISK_FLUSH_LIMIT, false) < STOCK_DISK_FLUSH_LIMIT)
+  {
+    stock_async.flush_time = now + STOCK_DISK_DELAY;
+  }
+}
+
+/*
+ * Mark the strings of stock as held, in marks
+ */
+static inline void stock_strings_mark(uint8_t* marks, const stock_t* stock)
+{
+  stock_id_t ids[] = { stock->symbol, stock->name, stock->exchange, stock->range, stock->interval, stock->currency };
+
+  for (size_t index = 0; index < sizeof(ids) / sizeof(stock_id_t); index++)
+  {
+    if (ids[index] > 0 && ids[index] < stock_strings.count)
+    {
+      marks[ids[index]] = 1;
+    }
+  }
+}
+
+/*
+ * Remove the strings that no stock holds, after stocks were freed
+ *
+ * Only the stocks in the index, the cache and the async engine are
+ * seen, so it is called from stock_async_run, between frames, when no
+ * other stock is alive
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to allocate memory
+ */
+static inline int stock_strings_sweep(void)
+{
+  size_t count = stock_strings.count;
+
+  if (count <= 1)
+  {
+    return 0;
+  }
+
+  uint8_t* marks = calloc(count, sizeof(uint8_t));
+
+  stock_id_t* frees = realloc(stock_strings.frees, sizeof(stock_id_t) * count);
+
+  if (!marks || !frees)
+  {
+    free(marks);
 
-  stock_resize(stock, stock->value_count);
+    // The frees only grow, so the old ones are still valid
+    if (frees) stock_strings.frees = frees;
 
-  return 0;
-}
+    return 1;
+  }
 
-/*
- * Free data of stock
- */
-static inline void stock_data_free(stock_t* stock)
-{
-  free(stock->values);
+  stock_strings.frees = frees;
+
+  for (size_t index = 0; index < stock_index.capacity; index++)
+  {
+    if (stock_index.entries[index].stock)
+    {
+      stock_strings_mark(marks, stock_index.entries[index].stock);
+    }
+  }
+
+  for (size_t index = 0; index < stock_cache.count; index++)
+  {
+    stock_strings_mark(marks, &stock_cache.entries[index].copy);
+  }
+
+  for (size_t index = 0; index < STOCK_ASYNC_LIMIT; index++)
+  {
+    stock_job_t* job = &stock_async.jobs[index];
+
+    if (!job->is_active) continue;
+
+    stock_strings_mark(marks, &job->copy);
+
+    if (job->stock) stock_strings_mark(marks, job->stock);
+  }
+
+  for (size_t index = 0; index < stock_async.poll_count; index++)
+  {
+    stock_strings_mark(marks, stock_async.polls[index].stock);
+  }
+
+  stock_strings.free_count = 0;
+
+  // The lowest ids are on top of the frees, to keep the ids dense
+  for (size_t id = count - 1; id > 0; id--)
+  {
+    if (marks[id]) continue;
 
-  free(stock->_values);
+    if (stock_strings.strings[id])
+    {
+      free(stock_strings.strings[id]);
 
-  free(stock->symbol);
+      stock_strings.strings[id] = NULL;
 
-  free(stock->name);
+      stock_strings.live_count--;
+    }
 
-  free(stock->exchange);
+    stock_strings.frees[stock_strings.free_count++] = id;
+  }
 
-  free(stock->currency);
+  free(marks);
 
-  free(stock->range);
+  stock_strings.sweep_count = stock_strings.live_count;
 
-  free(stock->interval);
+  // Drop the removed ids from the hash table
+  return stock_strings_slots_set(stock_strings.slot_count);
 }
 
 /*
- * Free stock object
+ * Add stock to the changed stocks, unless it is already there
+ *
+ * Stocks that do not fit in count are only counted
+ *
+ * RETURN (size_t changed_count)
  */
-void stock_free(stock_t** stock)
+static inline size_t stock_changed_add(stock_t** stocks, size_t count, size_t changed_count, stock_t* stock)
 {
-  if (!stock || !(*stock)) return;
-
-  stock_data_free(*stock);
+  for (size_t index = 0; index < MIN(changed_count, count); index++)
+  {
+    if (stocks[index] == stock)
+    {
+      return changed_count;
+    }
+  }
 
-  free(*stock);
+  if (changed_count < count)
+  {
+    stocks[changed_count] = stock;
+  }
 
-  *stock = NULL;
+  return changed_count + 1;
 }
 
 /*
- * Zoom existing stock to specified range and update 1d meta data
+ * Run asynchronous jobs without blocking, called from the main loop
  *
- * On error, stock is not affected
+ * The stocks whose data was replaced are stored in stocks, at most count
+ * of them, so that only their windows have to be rendered again
+ *
+ * RETURN (size_t changed_count)
+ * - 0  | No stock changed
+ * - >0 | Number of changed stocks, more than count if not all fit
  */
-int stock_zoom(stock_t* stock, char* range)
+size_t stock_async_run(stock_t** stocks, size_t count)
 {
-  const char* interval = stock_range_interval_get(range);
+  if (!stock_async.multi)
+  {
+    return 0;
+  }
 
-  if (!interval)
+  stock_polls_start();
+
+  stock_prefetches_start();
+
+  long now = stock_time_get();
+
+  // Add the replayed jobs whose latency has passed
+  for (size_t index = 0; index < STOCK_ASYNC_LIMIT; index++)
   {
-    return 1;
+    stock_job_t* job = &stock_async.jobs[index];
+
+    if (!job->is_active || job->due == 0 || now < job->due) continue;
+
+    if (curl_multi_add_handle(stock_async.multi, job->easy) == CURLM_OK)
+    {
+      job->due = 0;
+    }
+    else stock_job_stop(job);
   }
 
-  stock_t copy = (stock_t)
+  int running;
+
+  if (curl_multi_perform(stock_async.multi, &running) != CURLM_OK)
   {
-    .symbol   = strdup(stock->symbol),
-    .range    = strdup(range),
-    .interval = strdup(interval),
-  };
+    return 0;
+  }
 
-  if (stock_update(&copy) != 0)
+  size_t changed_count = 0;
+
+  CURLMsg* message;
+
+  int message_count;
+
+  while ((message = curl_multi_info_read(stock_async.multi, &message_count)))
   {
-    stock_data_free(&copy);
+    if (message->msg != CURLMSG_DONE) continue;
 
-    return 2;
+    stock_job_t* job = NULL;
+
+    curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char**) &job);
+
+    if (!job || !job->is_active) continue;
+
+    // The job is stopped when it is done
+    stock_t* stock = job->stock;
+
+    if (stock_job_done(job, message->data.result))
+    {
+      changed_count = stock_changed_add(stocks, count, changed_count, stock);
+    }
   }
 
-  stock_data_free(stock);
+  stock_disk_flush_step();
 
-  *stock = copy;
+  // Sweep once the strings have doubled, so sweeps stay rare
+  if (stock_strings.live_count >= MAX(stock_strings.sweep_count * 2, STOCK_STRINGS_SLOTS))
+  {
+    stock_strings_sweep();
+  }
 
-  return 0;
+  return changed_count;
 }
 
 /*
- * Update stock by fetching both specified range and 1d meta data
+ * Add stock to be refreshed in the background every poll delay
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Failed to initialize engine
+ * - 2 | Failed to realloc polls
  */
-int stock_update(stock_t* stock)
+int stock_poll_add(stock_t* stock)
 {
-  // 1. Fetch and update 1d meta data
-  char* range = "1d";
-
-  const char* interval = stock_range_interval_get(range);
+  for (size_t index = 0; index < stock_async.poll_count; index++)
+  {
+    if (stock_async.polls[index].stock == stock)
+    {
+      return 0;
+    }
+  }
 
-  if (!interval)
+  if (stock_async_init() != 0)
   {
     return 1;
   }
 
-  stock_t day = (stock_t)
+  stock_poll_t* polls = realloc(stock_async.polls, sizeof(stock_poll_t) * (stock_async.poll_count + 1));
+
+  if (!polls)
+  {
+    return 2;
+  }
+
+  stock_async.polls = polls;
+
+  // Stale stocks, like the ones from the disk cache, are polled right away
+  time_t now = time(NULL);
+
+  stock_async.polls[stock_async.poll_count++] = (stock_poll_t)
   {
-    .symbol   = strdup(stock->symbol),
-    .range    = strdup(range),
-    .interval = strdup(interval),
+    .stock = stock,
+    .time  = stock_data_is_fresh(stock) ? (now + stock_async.delay) : now,
   };
 
-  if (stock_fetch(&day) != 0)
+  return 0;
+}
+
+/*
+ * Stop refreshing stock in the background
+ */
+void stock_poll_remove(stock_t* stock)
+{
+  for (size_t index = 0; index < stock_async.poll_count; index++)
   {
-    stock_data_free(&day);
+    if (stock_async.polls[index].stock == stock)
+    {
+      stock_async.polls[index] = stock_async.polls[--stock_async.poll_count];
 
-    return 1;
+      break;
+    }
   }
 
-  if (stock_meta_calc(&day) != 0)
+  stock_job_t* job = stock_job_get(stock, STOCK_JOB_POLL);
+
+  if (job)
   {
-    stock_data_free(&day);
+    stock_job_stop(job);
+  }
+}
 
-    return 2;
+/*
+ * Set number of seconds between background refreshes
+ */
+void stock_poll_delay_set(int seconds)
+{
+  stock_async.delay = MAX(seconds, 1);
+}
+
+/*
+ * Cancel the zoom of stock that is in flight
+ */
+static inline void stock_zoom_cancel(stock_t* stock)
+{
+  stock_job_t* job = stock_job_get(stock, STOCK_JOB_ZOOM);
+
+  if (job)
+  {
+    stock_job_stop(job);
   }
+}
 
-  // 2. Fetch and update range values
-  stock_t copy = (stock_t)
+/*
+ * Start zoom job fetching range and interval of stock
+ *
+ * RETURN (stock_job_t* job)
+ * - NULL | No idle job, or failed to start job
+ */
+static inline stock_job_t* stock_zoom_job_start(stock_t* stock, stock_id_t range, stock_id_t interval)
+{
+  stock_job_t* job = stock_job_start(stock, range, interval, 0, STOCK_JOB_ZOOM);
+
+  // Make room by cancelling a poll, the zoom is what the user waits for
+  if (!job)
   {
-    .symbol   = strdup(stock->symbol),
-    .range    = strdup(stock->range),
-    .interval = strdup(stock->interval),
-  };
+    stock_job_t* poll = stock_job_get(NULL, STOCK_JOB_POLL);
+
+    if (poll)
+    {
+      stock_job_stop(poll);
+
+      job = stock_job_start(stock, range, interval, 0, STOCK_JOB_ZOOM);
+    }
+  }
+
+  return job;
+}
+
+/*
+ * Start zooming stock to range in the background
+ *
+ * A newer zoom cancels the zoom that is in flight, and the stock keeps
+ * its old range until the new data has arrived in stock_async_run
+ *
+ * RETURN (int status)
+ * - 0 | Success, or stock already has range
+ * - 1 | Bad range
+ * - 2 | Failed to start job
+ */
+int stock_zoom_start(stock_t* stock, char* string)
+{
+  stock_id_t range = stock_string_id_get(string);
+
+  stock_id_t interval = stock_string_id_get(stock_range_interval_get(string));
 
-  if (stock_fetch(&copy))
+  if (!interval)
   {
-    stock_data_free(&day);
+    return 1;
+  }
 
-    stock_data_free(&copy);
+  stock_zoom_cancel(stock);
 
-    return 3;
+  if (stock->range == range)
+  {
+    return 0;
   }
 
-  // Perserve 1d meta data
-  copy.high  = day.high;
-  copy.low   = day.low;
-  copy.open  = day.open;
-  copy.close = day.close;
-  copy.start = day.start;
-  copy.end   = day.end;
+  int status = stock_cache_zoom(stock, range);
 
-  stock_data_free(&day);
+  if (status == 1)
+  {
+    stock_update_start(stock);
+  }
 
-  stock_data_free(stock);
+  // The cached interval might be too coarse for the chart
+  if (status != 2)
+  {
+    stock_refine_start(stock);
+
+    return 0;
+  }
 
-  *stock = copy;
+  // The range is being prefetched, wait for it instead of fetching it again
+  stock_job_t* job = stock_prefetch_job_get(stock, range);
 
-  return 0;
+  if (job)
+  {
+    job->type = STOCK_JOB_ZOOM;
+
+    return 0;
+  }
+
+  return stock_zoom_job_start(stock, range, interval) ? 0 : 2;
 }
 
 /*
- * Create stock with symbol and 1d range data
+ * Get the range that stock is being zoomed to
+ *
+ * RETURN (const char* range)
+ * - NULL | Stock is not being zoomed
  */
-stock_t* stock_create(char* symbol)
+const char* stock_zoom_range_get(stock_t* stock)
 {
-  char* range = "1d";
+  stock_job_t* job = stock_job_get(stock, STOCK_JOB_ZOOM);
 
-  const char* interval = stock_range_interval_get(range);
+  return job ? stock_string_get(job->copy.range) : NULL;
+}
 
-  if (!interval)
+/*
+ * Create stock with symbol and 1d range data, like stock_create, but
+ * without blocking
+ *
+ * A stale cached range is updated in the background. A symbol that is
+ * not cached is fetched in the background, as a zoom of an empty stock,
+ * so stock_zoom_range_get returns its range while it is loading. If the
+ * fetch fails, the stock stays empty
+ *
+ * RETURN (stock_t* stock)
+ * - NULL | Failed to create stock, or to start fetching it
+ */
+stock_t* stock_create_start(char* symbol)
+{
+  stock_t* stock = stock_index_take(stock_string_id_get(symbol));
+
+  if (stock)
   {
-    return NULL;
+    return stock;
   }
 
-  stock_t* stock = malloc(sizeof(stock_t));
+  stock = stock_empty_create(symbol);
 
   if (!stock)
   {
     return NULL;
   }
 
-  memset(stock, 0, sizeof(stock_t));
+  int status = stock_cache_zoom(stock, stock->range);
 
-  *stock = (stock_t)
+  if (status == 1)
   {
-    .symbol   = strdup(symbol),
-    .range    = strdup(range),
-    .interval = strdup(interval),
-  };
+    stock_update_start(stock);
+  }
 
-  if (stock_fetch(stock) != 0)
+  if (status != 2)
+  {
+    return stock_index_share(stock);
+  }
+
+  if (!stock_zoom_job_start(stock, stock->range, stock->interval))
   {
     stock_free(&stock);
 
     return NULL;
   }
 
-  if (stock_meta_calc(stock) != 0)
+  return stock_index_share(stock);
+}
+
+/*
+ * Start fetching the range of stock again with a finer interval, if the
+ * view has fewer values than the chart has columns
+ *
+ * The finer range is swapped in like a zoom, keeping the time span of
+ * the view, so zooming in on a coarse range refines it
+ *
+ * RETURN (int status)
+ * - 0 | Success, or the interval is already fine enough
+ * - 1 | No values, or stock is being zoomed
+ * - 2 | Failed to start job
+ */
+int stock_refine_start(stock_t* stock)
+{
+  size_t end   = stock_view_end_get(stock);
+  size_t first = stock_view_first_get(stock);
+
+  if (end - first >= stock_columns)
   {
-    stock_free(&stock);
+    return 0;
+  }
 
-    return NULL;
+  if (end == 0 || stock_job_get(stock, STOCK_JOB_ZOOM))
+  {
+    return 1;
   }
 
-  return stock;
+  int64_t seconds = stock_interval_seconds_get(stock_string_get(stock->interval));
+
+  // The last candle of the view lasts until the end of its interval
+  int64_t span = stock->values.time[end - 1] - stock->values.time[first] + seconds;
+
+  size_t index = stock_interval_index_pick(stock_string_get(stock->range), span);
+
+  if (index == STOCK_INTERVAL_COUNT || stock_interval_seconds_get(STOCK_INTERVALS[index]) >= seconds)
+  {
+    return 0;
+  }
+
+  stock_id_t interval = stock_string_id_get(STOCK_INTERVALS[index]);
+
+  return stock_job_start(stock, stock->range, interval, 0, STOCK_JOB_ZOOM) ? 0 : 2;
+}
+
+/*
+ * Prefetch the other ranges of stock in the background, because it is
+ * probably going to be zoomed
+ *
+ * Only one stock is prefetched at a time, the last one that was focused
+ */
+void stock_prefetch_start(stock_t* stock)
+{
+  if (stock_async.prefetch_stock == stock) return;
+
+  stock_async.prefetch_stock = stock;
+
+  stock_async.prefetch_mask = 0;
+
+  for (size_t index = 0; index < STOCK_ASYNC_LIMIT; index++)
+  {
+    stock_job_t* job = &stock_async.jobs[index];
+
+    if (job->is_active && job->type == STOCK_JOB_PREFETCH && job->stock != stock)
+    {
+      stock_job_stop(job);
+    }
+  }
+}
+
+/*
+ * Stop everything the asynchronous engine does with stock, before it is freed
+ */
+static inline void stock_async_remove(stock_t* stock)
+{
+  stock_poll_remove(stock);
+
+  if (stock_async.prefetch_stock == stock)
+  {
+    stock_async.prefetch_stock = NULL;
+  }
+
+  for (size_t index = 0; index < STOCK_ASYNC_LIMIT; index++)
+  {
+    if (stock_async.jobs[index].stock == stock)
+    {
+      stock_job_stop(&stock_async.jobs[index]);
+    }
+  }
+}
+
+/*
+ * Free asynchronous engine, stopping all jobs
+ */
+static inline void stock_async_free(void)
+{
+  for (size_t index = 0; index < STOCK_ASYNC_LIMIT; index++)
+  {
+    stock_job_t* job = &stock_async.jobs[index];
+
+    stock_job_stop(job);
+
+    if (job->easy)
+    {
+      curl_easy_cleanup(job->easy);
+    }
+
+    stock_response_free(&job->response);
+  }
+
+  if (stock_async.multi)
+  {
+    curl_multi_cleanup(stock_async.multi);
+  }
+
+  free(stock_async.polls);
+
+  stock_async = (stock_async_t) { .delay = stock_async.delay };
 }
 
 #endif // STOCK_IMPLEMENT
@@ -44,6 +44,7 @@ typedef struct stocks_data_t
   tui_input_t* input;
   tui_list_t*  list;
   stock_t*     stock;
+  stock_t*     search; // Searched stock, while it is loading
 } stocks_data_t;
 
 /*
@@ -59,6 +60,8 @@ void stocks_window_free(tui_window_t* window)
 
   stock_free(&data->stock);
 
+  stock_free(&data->search);
+
   free(data);
 }
 
@@ -116,6 +119,38 @@ static inline int grid_stock_y_get(stock_t* stock, int h, double value)
   return (h - 1) - ((double) (h - 1) * (value - stock->_low) / (stock->_high - stock->_low));
 }
 
+/*
+ * Rows of the RSI band, below the price, and the least rows it needs
+ */
+#define CHART_RSI_ROWS_MIN 4
+
+/*
+ * Get the rows of the RSI band at the bottom of the chart
+ *
+ * The band is a quarter of the chart, and its top row is left empty to
+ * keep RSI apart from the price. RSI is left out of charts too short
+ * for the band
+ */
+static inline int chart_rsi_h_get(tui_window_t* head)
+{
+  if (!(stock_indicators_get() & (1 << STOCK_INDICATOR_RSI)))
+  {
+    return 0;
+  }
+
+  int h = head->_rect.h / 4;
+
+  return (h >= CHART_RSI_ROWS_MIN) ? h : 0;
+}
+
+/*
+ * Get the rows of the price, above the RSI band
+ */
+static inline int chart_price_h_get(tui_window_t* head)
+{
+  return head->_rect.h - chart_rsi_h_get(head);
+}
+
 /*
  * Data of stock window
  */
@@ -153,16 +188,16 @@ static void chart_window_cursor_render(tui_window_t* head)
   if (!stock) return;
 
   // Update cursor (value_index) based on resized stock
-  if (data->value_index >= stock->_value_count)
+  if (data->value_index >= stock->_values.count)
   {
-    data->value_index = stock->_value_count - 1;
+    data->value_index = stock->_values.count - 1;
   }
 
   int cursor_x = MAX(0, head->_rect.w - 1 - (int) data->value_index * 2);
 
-  double value = stock->_values[stock->_value_count - 1 - data->value_index].close;
+  double value = stock->_values.close[stock->_values.count - 1 - data->value_index];
 
-  int cursor_y = grid_stock_y_get(stock, head->_rect.h, value);
+  int cursor_y = grid_stock_y_get(stock, chart_price_h_get(head), value);
 
   short color = TUI_COLOR_YELLOW;
 
@@ -191,6 +226,76 @@ static void chart_window_cursor_render(tui_window_t* head)
   });
 }
 
+/*
+ * Colors of the indicator lines
+ */
+static const short LINE_COLORS[STOCK_LINE_COUNT] =
+{
+  [STOCK_LINE_SMA]             = TUI_COLOR_YELLOW,
+  [STOCK_LINE_EMA]             = TUI_COLOR_MAGENTA,
+  [STOCK_LINE_BOLLINGER_UPPER] = TUI_COLOR_CYAN,
+  [STOCK_LINE_BOLLINGER_LOWER] = TUI_COLOR_CYAN,
+  [STOCK_LINE_RSI]             = TUI_COLOR_GREEN,
+  [STOCK_LINE_VWAP]            = TUI_COLOR_BLUE,
+  [STOCK_LINE_DONCHIAN_UPPER]  = TUI_COLOR_WHITE,
+  [STOCK_LINE_DONCHIAN_LOWER]  = TUI_COLOR_WHITE,
+};
+
+/*
+ * Render the indicator lines over the chart
+ *
+ * RSI goes from 0 at the bottom to 100 at the top of its band, and the
+ * other lines use the same scale as the price
+ */
+static void chart_window_lines_render(tui_window_t* head)
+{
+  tui_window_grid_t* window = (tui_window_grid_t*) head;
+
+  stock_data_t* data = head->data;
+
+  stock_t* stock = data->stock;
+
+  const stock_lines_t* lines = &stock->_lines;
+
+  int mask = stock_indicators_get() & lines->mask;
+
+  int rsi_h = chart_rsi_h_get(head);
+
+  int price_h = head->_rect.h - rsi_h;
+
+  if (rsi_h == 0)
+  {
+    mask &= ~(1 << STOCK_INDICATOR_RSI);
+  }
+
+  for (stock_line_t line = 0; line < STOCK_LINE_COUNT; line++)
+  {
+    if (!stock_line_is_masked(line, mask)) continue;
+
+    for (int index = 0; index < lines->count; index++)
+    {
+      double value = lines->lines[line][lines->count - 1 - index];
+
+      if (isnan(value)) continue;
+
+      int x = (head->_rect.w - 1 - (index * 2));
+
+      int y = (line == STOCK_LINE_RSI) ?
+        (head->_rect.h - 1) - (rsi_h - 2) * value / 100 :
+        grid_stock_y_get(stock, price_h, value);
+
+      // Lines outside of the price range are not drawn over the RSI band
+      if (line != STOCK_LINE_RSI && (y < 0 || y >= price_h)) continue;
+
+      tui_window_grid_square_modify(window, x, y, (tui_window_grid_square_t)
+      {
+        .symbol   = '*',
+        .color.fg = LINE_COLORS[line],
+      });
+    }
+  }
+}
+
 /*
  * Render line chart
  */
@@ -213,33 +318,35 @@ void chart_window_line_render(tui_window_t* head)
     error_print("tui_window_grid_resize");
   }
 
-  // Limit stock to window size
+  // Limit stock to window size, and fetch ranges that fill it
+  stock_columns_set((head->_rect.w + 1) / 2);
+
   stock_resize(data->stock, (head->_rect.w + 1) / 2);
 
+  int price_h = chart_price_h_get(head);
+
   short color = (stock->_close > stock->_open) ? TUI_COLOR_GREEN : TUI_COLOR_RED;
 
-  for (int index = 0; index < stock->_value_count; index++)
-  {
-    if (index >= stock->_value_count) break;
+  const double* closes = stock->_values.close;
 
-    int x = (head->_rect.w - 1 - (index * 2));
+  size_t count = stock->_values.count;
 
-    stock_value_t value = stock->_values[stock->_value_count - 1 - index];
+  for (int index = 0; index < count; index++)
+  {
+    int x = (head->_rect.w - 1 - (index * 2));
 
-    int y = grid_stock_y_get(stock, head->_rect.h, value.close);
+    int y = grid_stock_y_get(stock, price_h, closes[count - 1 - index]);
 
     tui_window_grid_square_set(window, x, y, (tui_window_grid_square_t)
     {
       .color.bg = color,
     });
 
-    if (index + 1 >= stock->_value_count) break;
+    if (index + 1 >= count) break;
 
     x--;
 
-    stock_value_t next_value = stock->_values[stock->_value_count - 2 - index];
-
-    int next_y = grid_stock_y_get(stock, head->_rect.h, next_value.close);
+    int next_y = grid_stock_y_get(stock, price_h, closes[count - 2 - index]);
 
     // If the next y is equal to y or just 1 from it
     if (abs(next_y - y) <= 1)
@@ -265,6 +372,8 @@ void chart_window_line_render(tui_window_t* head)
     }
   }
 
+  chart_window_lines_render(head);
+
   if (head->tui->window == head)
   {
     chart_window_cursor_render(head);
@@ -293,24 +402,26 @@ void chart_window_candle_render(tui_window_t* head)
     error_print("tui_window_grid_resize");
   }
 
-  // Limit stock to window size
+  // Limit stock to window size, and fetch ranges that fill it
+  stock_columns_set((head->_rect.w + 1) / 2);
+
   stock_resize(data->stock, (head->_rect.w + 1) / 2);
 
-  for (int index = 0; index < stock->_value_count; index++)
-  {
-    if (index >= stock->_value_count) break;
+  int price_h = chart_price_h_get(head);
 
+  for (int index = 0; index < stock->_values.count; index++)
+  {
     int x = (head->_rect.w - 1 - (index * 2));
 
-    stock_value_t value = stock->_values[stock->_value_count - 1 - index];
+    stock_value_t value = stock_value_get(&stock->_values, stock->_values.count - 1 - index);
 
-    int close = grid_stock_y_get(stock, head->_rect.h, value.close);
+    int close = grid_stock_y_get(stock, price_h, value.close);
 
-    int open = grid_stock_y_get(stock, head->_rect.h, value.open);
+    int open = grid_stock_y_get(stock, price_h, value.open);
 
-    int low = grid_stock_y_get(stock, head->_rect.h, value.low);
+    int low = grid_stock_y_get(stock, price_h, value.low);
 
-    int high = grid_stock_y_get(stock, head->_rect.h, value.high);
+    int high = grid_stock_y_get(stock, price_h, value.high);
 
     int first = MIN(close, open);
 
@@ -348,6 +459,8 @@ void chart_window_candle_render(tui_window_t* head)
     }
   }
 
+  chart_window_lines_render(head);
+
   if (head->tui->window == head)
   {
     chart_window_cursor_render(head);
@@ -393,17 +506,53 @@ bool chart_window_key(tui_window_t* head, int key)
       return false;
 
     case KEY_LEFT:
-      if (data->value_index < (stock->_value_count - 1))
+      if (data->value_index < (stock->_values.count - 1))
       {
         data->value_index++;
 
         return true;
       }
 
-      data->value_index = stock->_value_count - 1;
+      data->value_index = stock->_values.count - 1;
 
       return false;
 
+    case KEY_UP:
+      if (stock_view_zoom(stock, 0.5) != 0)
+      {
+        return false;
+      }
+
+      // Fetch a finer interval, if the view has too few values
+      stock_refine_start(stock);
+
+      return true;
+
+    case KEY_DOWN:
+      return stock_view_zoom(stock, 2.0) == 0;
+
+    case '1': case '2': case '3': case '4': case '5': case '6':
+      stock_indicators_set(stock_indicators_get() ^ (1 << (key - '1')));
+
+      return true;
+
+    case 't':
+      if (stock_resize_mode_get() == STOCK_RESIZE_COUNT)
+      {
+        stock_resize_mode_set(STOCK_RESIZE_TIME);
+      }
+      else
+      {
+        stock_resize_mode_set(STOCK_RESIZE_COUNT);
+      }
+      return true;
+
+    case KEY_SLEFT: case 'h':
+      return stock_view_pan(stock, -0.25) == 0;
+
+    case KEY_SRIGHT: case 'l':
+      return stock_view_pan(stock, 0.25) == 0;
+
     case KEY_ESC:
       tui_window_parent_t* stocks_window = tui_window_window_parent_search(head, ". . . . stocks");
 
@@ -417,32 +566,32 @@ bool chart_window_key(tui_window_t* head, int key)
       return false;
 
     case 'u':
-      stock_update(stock);
+      stock_update_start(stock);
 
       return true;
 
     case 'd':
-      stock_zoom(stock, "1d");
+      stock_zoom_start(stock, "1d");
 
       return true;
 
     case 'w':
-      stock_zoom(stock, "1wk");
+      stock_zoom_start(stock, "1wk");
 
       return true;
 
     case 'm':
-      stock_zoom(stock, "1mo");
+      stock_zoom_start(stock, "1mo");
 
       return true;
 
     case 'y':
-      stock_zoom(stock, "1y");
+      stock_zoom_start(stock, "1y");
 
       return true;
 
     case 'x':
-      stock_zoom(stock, "max");
+      stock_zoom_start(stock, "max");
 
       return true;
 
@@ -470,7 +619,14 @@ void range_window_update(tui_window_t* head)
 
   char buffer[16];
 
-  sprintf(buffer, "%s", stock->range);
+  const char* range = stock_zoom_range_get(stock);
+
+  // Mark that the chart is loading another range
+  if (range)
+  {
+    sprintf(buffer, "%s > %s", stock_string_get(stock->range), range);
+  }
+  else sprintf(buffer, "%s", stock_string_get(stock->range));
 
   tui_window_text_string_set(window, buffer);
 }
@@ -490,6 +646,12 @@ void prices_window_update(tui_window_t* head)
 
   if (!stock) return;
 
+  // The chart renders after this, so the prices are of its resized values
+  if (data->chart)
+  {
+    stock_resize(stock, (data->chart->head._rect.w + 1) / 2);
+  }
+
   // 1. Free all child windows
   tui_windows_free(&window->children, &window->child_count);
 
@@ -675,9 +837,9 @@ void value_window_update(tui_window_t* head)
   stock_value_t value = { 0 };
 
   // If the cursor is within the chart, get cursor value
-  if (data->value_index < stock->_value_count)
+  if (data->value_index < stock->_values.count)
   {
-    value = stock->_values[stock->_value_count - data->value_index - 1];
+    value = stock_value_get(&stock->_values, stock->_values.count - data->value_index - 1);
   }
 
   char buffer[64];
@@ -715,7 +877,7 @@ void data_window_fill(tui_window_t* head)
 
   if (symbol)
   {
-    sprintf(buffer, "%s", stock->symbol);
+    sprintf(buffer, "%s", stock_string_get(stock->symbol));
 
     tui_window_text_string_set(symbol, buffer);
   }
@@ -725,7 +887,7 @@ void data_window_fill(tui_window_t* head)
 
   if (name)
   {
-    sprintf(buffer, "%s", stock->name);
+    sprintf(buffer, "%s", stock_string_get(stock->name));
 
     tui_window_text_string_set(name, buffer);
   }
@@ -735,7 +897,7 @@ void data_window_fill(tui_window_t* head)
 
   if (exchange)
   {
-    sprintf(buffer, "%s", stock->exchange);
+    sprintf(buffer, "%s", stock_string_get(stock->exchange));
 
     tui_window_text_string_set(exchange, buffer);
   }
@@ -745,7 +907,7 @@ void data_window_fill(tui_window_t* head)
 
   if (currency)
   {
-    sprintf(buffer, "%s", stock->currency);
+    sprintf(buffer, "%s", stock_string_get(stock->currency));
 
     tui_window_text_string_set(currency, buffer);
   }
@@ -1020,7 +1182,9 @@ bool item_window_key(tui_window_t* head, int key)
     case KEY_ENTR:
       if (data->chart)
       {
-        stock_zoom(stock, "1d");
+        stock_zoom_start(stock, "1d");
+
+        stock_prefetch_start(stock);
 
         data->stock = stock;
 
@@ -1122,7 +1286,7 @@ void item_window_update(tui_window_t* head)
 
   if (symbol_window)
   {
-    sprintf(buffer, "%s   ", stock->symbol);
+    sprintf(buffer, "%s   ", stock_string_get(stock->symbol));
 
     tui_window_text_string_set(symbol_window, buffer);
   }
@@ -1264,6 +1428,33 @@ bool list_window_key(tui_window_t* head, int key)
   return false;
 }
 
+/*
+ * Get path of file in the .stocks directory in the home directory
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | HOME is not set
+ * - 2 | Path does not fit in size
+ */
+static int stocks_path_get(char* path, size_t size, const char* file)
+{
+  const char* home = getenv("HOME");
+
+  if (!home)
+  {
+    return 1;
+  }
+
+  int length = snprintf(path, size, "%s/.stocks/%s", home, file);
+
+  if (length < 0 || length >= size)
+  {
+    return 2;
+  }
+
+  return 0;
+}
+
 /*
  * Initialize list window, creating item windows for default stocks
  */
@@ -1273,9 +1464,12 @@ void list_window_init(tui_window_t* head)
 
   stocks_data_t* data = head->data;
 
-  char stocks_file[64];
+  char stocks_file[PATH_MAX] = "";
 
-  sprintf(stocks_file, "%s/.stocks/stocks.txt", getenv("HOME"));
+  if (stocks_path_get(stocks_file, sizeof(stocks_file), "stocks.txt") != 0)
+  {
+    error_print("Failed to get stocks file");
+  }
 
   size_t file_size = file_size_get(stocks_file);
 
@@ -1283,14 +1477,24 @@ void list_window_init(tui_window_t* head)
 
   size_t count = file_lines_read(&symbols, file_size, stocks_file);
 
-  for (size_t index = 0; index < count; index++)
+  stock_t** stocks = malloc(sizeof(stock_t*) * count);
+
+  if (stocks)
   {
-    char* symbol = symbols[index];
+    stock_create_many(stocks, symbols, count, STOCK_MULTI_LIMIT);
+  }
 
-    stock_t* stock = stock_create(symbol);
+  for (size_t index = 0; stocks && index < count; index++)
+  {
+    stock_t* stock = stocks[index];
 
     if (!stock) continue;
 
+    // The interned symbol outlives the symbols of the file
+    char* symbol = (char*) stock_string_get(stock->symbol);
+
+    stock_poll_add(stock);
+
     tui_window_parent_t* item_window = tui_parent_child_parent_create(list_window, (tui_window_parent_config_t)
     {
       .name         = symbol,
@@ -1313,6 +1517,8 @@ void list_window_init(tui_window_t* head)
     tui_list_item_add(data->list, (tui_window_t*) item_window);
   }
 
+  free(stocks);
+
   file_lines_free(&symbols, count);
 
   // Creating invisable window to give list window some min structure
@@ -1357,10 +1563,36 @@ void search_window_exit(tui_window_t* head)
 }
 
 /*
- * Keypress handler for search window, on enter view inputted stock's chart
+ * Show the searched stock in the chart, once it has loaded
+ *
+ * A symbol of the list shares the stock of its item, so it is loaded
+ * right away. A searched symbol that failed to load is dropped
+ *
+ * RETURN (bool is_done)
+ * - true  | The stock was shown or dropped
+ * - false | No stock is loading, or it is still loading
  */
-bool search_window_key(tui_window_t* head, int key)
+static bool search_stock_open(tui_window_t* head)
 {
+  stocks_data_t* data = head->data;
+
+  if (!data || !data->search)
+  {
+    return false;
+  }
+
+  if (data->search->values.count == 0)
+  {
+    if (stock_zoom_range_get(data->search))
+    {
+      return false;
+    }
+
+    stock_free(&data->search);
+
+    return true;
+  }
+
   tui_window_parent_t* stock_window = tui_window_window_parent_search(head, ". . stock");
 
   if (!stock_window)
@@ -1375,6 +1607,43 @@ bool search_window_key(tui_window_t* head, int key)
     return false;
   }
 
+  stock_free(&data->stock);
+
+  data->stock = data->search;
+
+  data->search = NULL;
+
+  stock_poll_add(data->stock);
+
+  stock_prefetch_start(data->stock);
+
+  stock_data->stock = data->stock;
+
+  tui_window_grid_t* chart_window = stock_data->chart;
+
+  if (chart_window)
+  {
+    tui_window_set(head->tui, (tui_window_t*) chart_window);
+
+    tui_window_parent_t* data_window = tui_window_window_parent_search((tui_window_t*) stock_window, "data");
+
+    if (data_window)
+    {
+      data_window_fill((tui_window_t*) data_window);
+    }
+  }
+
+  return true;
+}
+
+/*
+ * Keypress handler for search window, on enter view inputted stock's chart
+ *
+ * The stock is loaded in the background, and shown by tick_event when
+ * it has loaded, so the keys are not blocked by the fetch
+ */
+bool search_window_key(tui_window_t* head, int key)
+{
   stocks_data_t* data = head->data;
 
   if (!data)
@@ -1386,37 +1655,92 @@ bool search_window_key(tui_window_t* head, int key)
   {
     char* symbol = data->input->buffer;
 
-    stock_t* stock = stock_create(symbol);
+    stock_t* stock = stock_create_start(symbol);
 
     if (!stock)
     {
       return true;
     }
 
-    stock_free(&data->stock);
+    stock_free(&data->search);
 
-    data->stock = stock;
+    data->search = stock;
 
-    stock_data->stock = data->stock;
+    search_stock_open(head);
+
+    return true;
+  }
 
-    tui_window_grid_t* chart_window = stock_data->chart;
+  return false;
+}
 
-    if (chart_window)
-    {
-      tui_window_set(head->tui, (tui_window_t*) chart_window);
+/*
+ * Max number of changed stocks to refresh the windows of in one tick
+ */
+#define TICK_STOCK_COUNT 16
+
+/*
+ * Refresh the list items and the stock window that show stock
+ */
+static void stock_windows_refresh(tui_t* tui, stock_t* stock)
+{
+  tui_window_t* list_window = tui_menu_window_search(tui->menu, "root stocks list");
 
-      tui_window_parent_t* data_window = tui_window_window_parent_search((tui_window_t*) stock_window, "data");
+  if (list_window && list_window->type == TUI_WINDOW_PARENT)
+  {
+    tui_window_parent_t* parent = (tui_window_parent_t*) list_window;
 
-      if (data_window)
+    for (size_t index = 0; index < parent->child_count; index++)
+    {
+      tui_window_t* item_window = parent->children[index];
+
+      if (item_window->data == stock)
       {
-        data_window_fill((tui_window_t*) data_window);
+        tui_window_refresh(item_window);
       }
     }
+  }
 
-    return true;
+  tui_window_t* stock_window = tui_menu_window_search(tui->menu, "root stock");
+
+  if (stock_window)
+  {
+    stock_data_t* stock_data = stock_window->data;
+
+    if (stock_data && stock_data->stock == stock)
+    {
+      tui_window_refresh(stock_window);
+    }
   }
+}
 
-  return false;
+/*
+ * Run background stock updates, and refresh the windows of the stocks
+ * that changed, instead of rendering every window
+ *
+ * Render everything if more stocks changed than can be refreshed, or
+ * if the searched stock has loaded and its chart is shown
+ */
+bool tick_event(tui_t* tui)
+{
+  stock_t* stocks[TICK_STOCK_COUNT];
+
+  size_t count = stock_async_run(stocks, TICK_STOCK_COUNT);
+
+  if (count > TICK_STOCK_COUNT || !tui->menu)
+  {
+    return (count > 0);
+  }
+
+  for (size_t index = 0; index < count; index++)
+  {
+    stock_windows_refresh(tui, stocks[index]);
+  }
+
+  tui_window_t* search_window = tui_menu_window_search(tui->menu, "root stocks search");
+
+  // The searched stock has loaded, and the chart is shown
+  return search_window && search_stock_open(search_window);
 }
 
 /*
@@ -1596,31 +1920,116 @@ void tui_init(tui_t* tui)
   tui_menu_window_search_set(menu, "root stocks list");
 }
 
+/*
+ * Parse arguments selecting where the stocks are fetched from
+ *
+ * stocks [--record <dir> | --replay <dir>] [--latency <ms>]
+ *
+ * RETURN (int status)
+ * - 0 | Success
+ * - 1 | Bad arguments
+ * - 2 | Bad directory
+ */
+int args_parse(int argc, char* argv[])
+{
+  stock_mode_t mode = STOCK_MODE_LIVE;
+
+  char* dir = NULL;
+
+  int latency = 0;
+
+  for (int index = 1; index < argc; index++)
+  {
+    char* arg = argv[index];
+
+    if (index + 1 >= argc)
+    {
+      return 1;
+    }
+
+    if (strcmp(arg, "--record") == 0)
+    {
+      mode = STOCK_MODE_RECORD;
+    }
+    else if (strcmp(arg, "--replay") == 0)
+    {
+      mode = STOCK_MODE_REPLAY;
+    }
+    else if (strcmp(arg, "--latency") == 0)
+    {
+      latency = atoi(argv[++index]);
+
+      continue;
+    }
+    else return 1;
+
+    dir = argv[++index];
+  }
+
+  if (stock_backend_set(mode, dir, latency) != 0)
+  {
+    return 2;
+  }
+
+  return 0;
+}
+
 /*
  * Main function
  */
 int main(int argc, char* argv[])
 {
-  char debug_file[64];
+  if (args_parse(argc, argv) != 0)
+  {
+    fprintf(stderr, "Usage: %s [--record <dir> | --replay <dir>] [--latency <ms>]\n", argv[0]);
+
+    return 1;
+  }
+
+  char debug_file[PATH_MAX];
 
-  if (sprintf(debug_file, "%s/.stocks/debug.log", getenv("HOME")) < 0)
+  if (stocks_path_get(debug_file, sizeof(debug_file), "debug.log") != 0)
   {
+    fprintf(stderr, "Failed to get debug file, HOME is not set or too long\n");
+
     return 1;
   }
 
   debug_file_open(debug_file);
 
+  char cache_dir[PATH_MAX];
+
+  if (stocks_path_get(cache_dir, sizeof(cache_dir), "cache") != 0)
+  {
+    error_print("Failed to get disk cache directory");
+  }
+  else if (stock_disk_dir_set(cache_dir) != 0)
+  {
+    error_print("Failed to set disk cache: %s", cache_dir);
+  }
+
+  if (stock_init() != 0)
+  {
+    debug_file_close();
+
+    return 2;
+  }
+
   tui_t* tui = tui_create((tui_config_t)
   {
     .event.key  = &tab_event,
     .event.init = &tui_init,
+    .event.tick = &tick_event,
+    .delay      = 50,
   });
 
   if (!tui)
   {
+    stock_quit();
+
     debug_file_close();
 
-    return 2;
+    return 3;
   }
 
   tui_start(tui);
@@ -1629,6 +2038,8 @@ int main(int argc, char* argv[])
 
   tui_delete(&tui);
 
+  stock_quit();
+
   debug_file_close();
 
   return 0;
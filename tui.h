@@ -76,11 +76,17 @@ typedef struct tui_menu_event_t
 
 /*
  * Tui event struct
+ *
+ * key  - on keypress
+ * init - after initialization
+ * tick - after keypress, or delay ms without one (render if true,
+ *        or refresh single windows with tui_window_refresh)
  */
 typedef struct tui_event_t
 {
   bool (*key)  (tui_t* tui, int key);
   void (*init) (tui_t* tui);
+  bool (*tick) (tui_t* tui);
 } tui_event_t;
 
 /*
@@ -337,6 +343,7 @@ typedef struct tui_t
   tui_color_t    color;
   tui_cursor_t   cursor;
   tui_event_t    event;
+  int            delay;
   bool           is_running;
 } tui_t;
 
@@ -591,11 +598,14 @@ static inline void tui_ncurses_window_fill(WINDOW* window)
 
 /*
  * Configuration struct for creating tui
+ *
+ * delay - ms to wait for keypress before tick event, 0 waits forever
  */
 typedef struct tui_config_t
 {
   tui_color_t color;
   tui_event_t event;
+  int         delay;
 } tui_config_t;
 
 /*
@@ -624,9 +634,15 @@ tui_t* tui_create(tui_config_t config)
     .size.w = getmaxx(stdscr),
     .size.h = getmaxy(stdscr),
     .event  = config.event,
-    .color  = config.color
+    .color  = config.color,
+    .delay  = config.delay,
   };
 
+  if (tui->delay > 0)
+  {
+    wtimeout(stdscr, tui->delay);
+  }
+
   if (tui->event.init)
   {
     tui->event.init(tui);
@@ -2252,6 +2268,42 @@ void tui_render(tui_t* tui)
   }
 }
 
+/*
+ * Update and render window on its own, without rendering the rest of tui
+ *
+ * The children are laid out again within the rect of the window, which is
+ * kept until the next tui_render. The window is then copied up through its
+ * parents to the screen, so it should not be covered by other windows
+ */
+void tui_window_refresh(tui_window_t* window)
+{
+  for (tui_window_t* head = window; head; head = (tui_window_t*) head->parent)
+  {
+    if (!head->_is_visable || !head->window) return;
+  }
+
+  tui_windows_update(&window, 1);
+
+  if (window->type == TUI_WINDOW_PARENT)
+  {
+    tui_window_parent_t* parent = (tui_window_parent_t*) window;
+
+    tui_windows_size_calc(parent->children, parent->child_count);
+
+    tui_children_rect_calc(parent);
+  }
+
+  tui_window_render(window);
+
+  // The window is rendered into its parent, copy the parents up to the screen
+  for (tui_window_parent_t* parent = window->parent; parent; parent = parent->head.parent)
+  {
+    WINDOW* grandparent = parent->head.parent ? parent->head.parent->head.window : stdscr;
+
+    overwrite(parent->head.window, grandparent);
+  }
+}
+
 /*
  * Configuration struct for parent window
  */
@@ -2447,9 +2499,19 @@ int tui_window_grid_resize(tui_window_grid_t* window, tui_size_t size)
     return 1;
   }
 
+  int square_count = size.w * size.h;
+
+  // Just clear the grid if the size is the same
+  if (window->grid && window->_size.w == size.w && window->_size.h == size.h)
+  {
+    memset(window->grid, 0, sizeof(tui_window_grid_square_t) * square_count);
+
+    return 0;
+  }
+
   free(window->grid);
 
-  int square_count = size.w * size.h;
+  window->grid = NULL;
 
   tui_window_grid_square_t* grid = malloc(sizeof(tui_window_grid_square_t) * square_count);
 
@@ -3436,6 +3498,8 @@ void tui_start(tui_t* tui)
 
   while (tui->is_running && (key = wgetch(stdscr)))
   {
+    bool is_changed = (key != ERR);
+
     if (key == KEY_CTRLC)
     {
       tui->is_running = false;
@@ -3448,9 +3512,20 @@ void tui_start(tui_t* tui)
       tui_resize(tui);
     }
 
-    tui_event(tui, key);
+    if (key != ERR)
+    {
+      tui_event(tui, key);
+    }
+
+    if (tui->event.tick && tui->event.tick(tui))
+    {
+      is_changed = true;
+    }
 
-    tui_render(tui);
+    if (is_changed)
+    {
+      tui_render(tui);
+    }
   }
 }
 